@@ -0,0 +1,479 @@
+// Measures the cost of finding a node's type while walking the AST. The
+// heap-allocated node classes the parser used to build are reproduced below,
+// probed first with the evaluator's old dynamic_cast chains and then with a
+// switch on a kind tag. The same tree is then walked in the flat Ast arena.
+// Every walker does the same trivial work per node, so the difference between
+// them is the dispatch and memory layout cost.
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+
+namespace legacy {
+
+enum class Kind : uint8_t {
+    Literal,
+    Identifier,
+    Binary,
+    DynamicDeclaration,
+    ExpressionStatement,
+    PrintStatement,
+    Block,
+    If,
+    Loop,
+    Program
+};
+
+class Expression {
+public:
+    const Kind kind;
+
+    explicit Expression(Kind k) : kind(k) {}
+    virtual ~Expression() = default;
+};
+
+class Declaration {
+public:
+    const Kind kind;
+
+    explicit Declaration(Kind k) : kind(k) {}
+    virtual ~Declaration() = default;
+};
+
+class Statement : public Declaration {
+public:
+    explicit Statement(Kind k) : Declaration(k) {}
+};
+
+class Literal : public Expression {
+public:
+    std::string value;
+    TokenType type;
+
+    Literal(std::string val, TokenType t)
+        : Expression(Kind::Literal), value(std::move(val)), type(t) {}
+};
+
+class Identifier : public Expression {
+public:
+    std::string identifier_name;
+
+    Identifier(std::string name)
+        : Expression(Kind::Identifier), identifier_name(std::move(name)) {}
+};
+
+class BinaryExpression : public Expression {
+public:
+    std::unique_ptr<Expression> left;
+    TokenType op;
+    std::unique_ptr<Expression> right;
+
+    BinaryExpression(std::unique_ptr<Expression> l, TokenType o, std::unique_ptr<Expression> r)
+        : Expression(Kind::Binary), left(std::move(l)), op(o), right(std::move(r)) {}
+};
+
+class DynamicDeclaration : public Declaration {
+public:
+    std::string variable_name;
+    std::unique_ptr<Expression> value;
+
+    DynamicDeclaration(std::string name, std::unique_ptr<Expression> val)
+        : Declaration(Kind::DynamicDeclaration),
+          variable_name(std::move(name)), value(std::move(val)) {}
+};
+
+class ExpressionStatement : public Statement {
+public:
+    std::unique_ptr<Expression> expr;
+
+    ExpressionStatement(std::unique_ptr<Expression> e)
+        : Statement(Kind::ExpressionStatement), expr(std::move(e)) {}
+};
+
+class PrintStatement : public Statement {
+public:
+    std::unique_ptr<Expression> expression;
+
+    PrintStatement(std::unique_ptr<Expression> expr)
+        : Statement(Kind::PrintStatement), expression(std::move(expr)) {}
+};
+
+class Block : public Statement {
+public:
+    std::vector<std::unique_ptr<Declaration>> declarations;
+
+    Block(std::vector<std::unique_ptr<Declaration>> stmts)
+        : Statement(Kind::Block), declarations(std::move(stmts)) {}
+};
+
+class IfStatement : public Statement {
+public:
+    std::unique_ptr<Expression> condition;
+    std::unique_ptr<Block> if_block;
+    std::unique_ptr<Block> else_block;
+
+    IfStatement(std::unique_ptr<Expression> cond, std::unique_ptr<Block> ib, std::unique_ptr<Block> eb)
+        : Statement(Kind::If),
+          condition(std::move(cond)), if_block(std::move(ib)), else_block(std::move(eb)) {}
+};
+
+class LoopStatement : public Statement {
+public:
+    std::unique_ptr<Expression> condition;
+    std::unique_ptr<Block> loop_block;
+
+    LoopStatement(std::unique_ptr<Expression> cond, std::unique_ptr<Block> lb)
+        : Statement(Kind::Loop), condition(std::move(cond)), loop_block(std::move(lb)) {}
+};
+
+class Program : public Declaration {
+public:
+    std::vector<std::unique_ptr<Declaration>> declarations;
+
+    Program(std::vector<std::unique_ptr<Declaration>> decls)
+        : Declaration(Kind::Program), declarations(std::move(decls)) {}
+};
+
+}
+
+namespace {
+
+using namespace legacy;
+
+using Declarations = std::vector<std::unique_ptr<Declaration>>;
+
+// Builds the expression from tests/test_integer_expression.ia with every
+// literal replaced by a copy of the expression, `depth` times over.
+std::unique_ptr<Expression> deep_expression(int depth) {
+    auto leaf = [depth](const char* number) -> std::unique_ptr<Expression> {
+        if (depth == 0) {
+            return std::make_unique<Literal>(number, TokenType::Number);
+        }
+        return deep_expression(depth - 1);
+    };
+    auto binary = [](std::unique_ptr<Expression> l, TokenType op, std::unique_ptr<Expression> r) {
+        return std::make_unique<BinaryExpression>(std::move(l), op, std::move(r));
+    };
+
+    auto inner = binary(leaf("2"), TokenType::Plus,
+                        binary(leaf("5"), TokenType::Multiply,
+                               binary(leaf("3"), TokenType::Minus, leaf("1"))));
+    auto sum = binary(binary(binary(std::move(inner), TokenType::Plus, leaf("1")),
+                             TokenType::Plus, binary(leaf("4"), TokenType::Minus, leaf("3"))),
+                      TokenType::Plus, leaf("3"));
+    sum = binary(std::move(sum), TokenType::Plus,
+                 binary(std::make_unique<Identifier>("x"), TokenType::Plus, leaf("3")));
+    return binary(std::move(sum), TokenType::Plus,
+                  binary(binary(leaf("4"), TokenType::Divide, leaf("2")), TokenType::Divide,
+                         binary(leaf("9"), TokenType::Multiply, leaf("2"))));
+}
+
+std::unique_ptr<Block> block_of(std::unique_ptr<Declaration> declaration) {
+    Declarations declarations;
+    declarations.push_back(std::move(declaration));
+    return std::make_unique<Block>(std::move(declarations));
+}
+
+// A program that mixes every statement kind, so the declaration chains are
+// exercised at all of their depths.
+std::unique_ptr<Program> build_program(int statements, int depth) {
+    Declarations declarations;
+    for (int i = 0; i < statements; i++) {
+        switch (i % 5) {
+            case 0:
+                declarations.push_back(std::make_unique<DynamicDeclaration>("x", deep_expression(depth)));
+                break;
+            case 1:
+                declarations.push_back(std::make_unique<PrintStatement>(deep_expression(depth)));
+                break;
+            case 2:
+                declarations.push_back(block_of(std::make_unique<ExpressionStatement>(deep_expression(depth))));
+                break;
+            case 3:
+                declarations.push_back(std::make_unique<IfStatement>(
+                    deep_expression(depth),
+                    block_of(std::make_unique<PrintStatement>(deep_expression(depth))), nullptr));
+                break;
+            default:
+                declarations.push_back(std::make_unique<LoopStatement>(
+                    deep_expression(depth),
+                    block_of(std::make_unique<DynamicDeclaration>("x", deep_expression(depth)))));
+                break;
+        }
+    }
+    return std::make_unique<Program>(std::move(declarations));
+}
+
+// Copies a legacy tree into the flat arena, keeping the same shape.
+struct Flattener {
+    Ast ast;
+
+    NodeIndex expression(const Expression* expr) {
+        switch (expr->kind) {
+            case Kind::Binary: {
+                auto binary = static_cast<const BinaryExpression*>(expr);
+                NodeIndex left = expression(binary->left.get());
+                NodeIndex right = expression(binary->right.get());
+                return ast.add_node(::NodeKind::Binary, binary->op, left, right);
+            }
+            case Kind::Identifier:
+                return ast.add_node(::NodeKind::Identifier, TokenType::Identifier,
+                                    ast.interner.intern(static_cast<const Identifier*>(expr)->identifier_name));
+            default: {
+                auto literal = static_cast<const Literal*>(expr);
+                return ast.add_node(::NodeKind::Literal, literal->type,
+                                    ast.add_constant(std::stoi(literal->value)));
+            }
+        }
+    }
+
+    NodeIndex list(::NodeKind kind, const std::vector<std::unique_ptr<Declaration>>& declarations) {
+        std::vector<NodeIndex> list;
+        for (const auto& declaration : declarations) {
+            list.push_back(this->declaration(declaration.get()));
+        }
+        uint32_t first = ast.add_children(list);
+        return ast.add_node(kind, TokenType::Eof, first, static_cast<uint32_t>(list.size()), no_scope);
+    }
+
+    NodeIndex declaration(const Declaration* declaration) {
+        switch (declaration->kind) {
+            case Kind::DynamicDeclaration: {
+                auto decl = static_cast<const DynamicDeclaration*>(declaration);
+                Symbol name = ast.interner.intern(decl->variable_name);
+                return ast.add_node(::NodeKind::DynamicDeclaration, TokenType::Set, name,
+                                    expression(decl->value.get()));
+            }
+            case Kind::PrintStatement:
+                return ast.add_node(::NodeKind::PrintStatement, TokenType::ConsoleOut,
+                                    expression(static_cast<const PrintStatement*>(declaration)->expression.get()));
+            case Kind::ExpressionStatement:
+                return ast.add_node(::NodeKind::ExpressionStatement, TokenType::Eof,
+                                    expression(static_cast<const ExpressionStatement*>(declaration)->expr.get()));
+            case Kind::Block:
+                return list(::NodeKind::Block, static_cast<const Block*>(declaration)->declarations);
+            case Kind::If: {
+                auto if_stmnt = static_cast<const IfStatement*>(declaration);
+                NodeIndex condition = expression(if_stmnt->condition.get());
+                NodeIndex block = list(::NodeKind::Block, if_stmnt->if_block->declarations);
+                return ast.add_node(::NodeKind::If, TokenType::If, condition, block, no_node);
+            }
+            default: {
+                auto loop = static_cast<const LoopStatement*>(declaration);
+                NodeIndex condition = expression(loop->condition.get());
+                NodeIndex block = list(::NodeKind::Block, loop->loop_block->declarations);
+                return ast.add_node(::NodeKind::Loop, TokenType::Loop, condition, block);
+            }
+        }
+    }
+};
+
+struct RttiWalker {
+    long nodes = 0;
+
+    long expression(const Expression* expr) {
+        nodes++;
+        if (auto binary = dynamic_cast<const BinaryExpression*>(expr)) {
+            return expression(binary->left.get()) + expression(binary->right.get()) +
+                   static_cast<long>(binary->op);
+        } else if (dynamic_cast<const Identifier*>(expr)) {
+            return 1;
+        } else if (auto literal = dynamic_cast<const Literal*>(expr)) {
+            return static_cast<long>(literal->value.size());
+        }
+        return 0;
+    }
+
+    long block(const Block* block) {
+        long sum = 0;
+        for (const auto& declaration : block->declarations) {
+            sum += this->declaration(declaration.get());
+        }
+        return sum;
+    }
+
+    long declaration(const Declaration* declaration) {
+        nodes++;
+        if (auto decl = dynamic_cast<const DynamicDeclaration*>(declaration)) {
+            return expression(decl->value.get());
+        } else if (dynamic_cast<const Statement*>(declaration)) {
+            if (auto print_stmt = dynamic_cast<const PrintStatement*>(declaration)) {
+                return expression(print_stmt->expression.get());
+            } else if (auto expr_stmt = dynamic_cast<const ExpressionStatement*>(declaration)) {
+                return expression(expr_stmt->expr.get());
+            } else if (auto inner = dynamic_cast<const Block*>(declaration)) {
+                return block(inner);
+            } else if (auto if_stmnt = dynamic_cast<const IfStatement*>(declaration)) {
+                return expression(if_stmnt->condition.get()) + block(if_stmnt->if_block.get());
+            } else if (auto loop = dynamic_cast<const LoopStatement*>(declaration)) {
+                return expression(loop->condition.get()) + block(loop->loop_block.get());
+            }
+        }
+        return 0;
+    }
+};
+
+struct TaggedWalker {
+    long nodes = 0;
+
+    long expression(const Expression* expr) {
+        nodes++;
+        switch (expr->kind) {
+            case Kind::Binary: {
+                auto binary = static_cast<const BinaryExpression*>(expr);
+                return expression(binary->left.get()) + expression(binary->right.get()) +
+                       static_cast<long>(binary->op);
+            }
+            case Kind::Identifier:
+                return 1;
+            case Kind::Literal:
+                return static_cast<long>(static_cast<const Literal*>(expr)->value.size());
+            default:
+                return 0;
+        }
+    }
+
+    long block(const Block* block) {
+        long sum = 0;
+        for (const auto& declaration : block->declarations) {
+            sum += this->declaration(declaration.get());
+        }
+        return sum;
+    }
+
+    long declaration(const Declaration* declaration) {
+        nodes++;
+        switch (declaration->kind) {
+            case Kind::DynamicDeclaration:
+                return expression(static_cast<const DynamicDeclaration*>(declaration)->value.get());
+            case Kind::PrintStatement:
+                return expression(static_cast<const PrintStatement*>(declaration)->expression.get());
+            case Kind::ExpressionStatement:
+                return expression(static_cast<const ExpressionStatement*>(declaration)->expr.get());
+            case Kind::Block:
+                return block(static_cast<const Block*>(declaration));
+            case Kind::If: {
+                auto if_stmnt = static_cast<const IfStatement*>(declaration);
+                return expression(if_stmnt->condition.get()) + block(if_stmnt->if_block.get());
+            }
+            case Kind::Loop: {
+                auto loop = static_cast<const LoopStatement*>(declaration);
+                return expression(loop->condition.get()) + block(loop->loop_block.get());
+            }
+            default:
+                return 0;
+        }
+    }
+};
+
+struct FlatWalker {
+    const Ast& ast;
+    long nodes = 0;
+
+    long expression(NodeIndex index) {
+        nodes++;
+        const Node& expr = ast.node(index);
+        switch (expr.kind) {
+            case ::NodeKind::Binary:
+                return expression(expr.first) + expression(expr.second) + static_cast<long>(expr.op);
+            case ::NodeKind::Identifier:
+                return 1;
+            case ::NodeKind::Literal:
+                return static_cast<long>(expr.first);
+            default:
+                return 0;
+        }
+    }
+
+    long block(const Node& block) {
+        long sum = 0;
+        for (NodeIndex declaration : ast.block_children(block)) {
+            sum += this->declaration(declaration);
+        }
+        return sum;
+    }
+
+    long declaration(NodeIndex index) {
+        nodes++;
+        const Node& declaration = ast.node(index);
+        switch (declaration.kind) {
+            case ::NodeKind::DynamicDeclaration:
+                return expression(declaration.second);
+            case ::NodeKind::PrintStatement:
+            case ::NodeKind::ExpressionStatement:
+                return expression(declaration.first);
+            case ::NodeKind::Block:
+                return block(declaration);
+            case ::NodeKind::If:
+            case ::NodeKind::Loop:
+                return expression(declaration.first) + block(ast.node(declaration.second));
+            default:
+                return 0;
+        }
+    }
+};
+
+double flat_nanoseconds_per_node(const Ast& ast, int repetitions, long& checksum) {
+    FlatWalker walker{ast};
+    const Node& root = ast.node(ast.root);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++) {
+        checksum += walker.block(root);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(walker.nodes);
+}
+
+template<typename Walker>
+double nanoseconds_per_node(const Program* program, int repetitions, long& checksum) {
+    Walker walker;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++) {
+        for (const auto& declaration : program->declarations) {
+            checksum += walker.declaration(declaration.get());
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(walker.nodes);
+}
+
+}
+
+int main() {
+    const int repetitions = 20;
+    long total_checksum = 0;
+    std::printf("%-6s %-10s %-14s %-14s %-14s %s\n", "depth", "nodes", "rtti ns/node",
+                "tag ns/node", "flat ns/node", "speedup");
+
+    for (int depth : {0, 1, 2}) {
+        auto program = build_program(2000, depth);
+        Flattener flattener;
+        flattener.ast.root = flattener.list(::NodeKind::Program, program->declarations);
+        long checksum = 0;
+
+        // Warm up both walkers once before timing.
+        nanoseconds_per_node<RttiWalker>(program.get(), 1, checksum);
+        nanoseconds_per_node<TaggedWalker>(program.get(), 1, checksum);
+        flat_nanoseconds_per_node(flattener.ast, 1, checksum);
+
+        RttiWalker counter;
+        for (const auto& declaration : program->declarations) {
+            counter.declaration(declaration.get());
+        }
+
+        double rtti = nanoseconds_per_node<RttiWalker>(program.get(), repetitions, checksum);
+        double tagged = nanoseconds_per_node<TaggedWalker>(program.get(), repetitions, checksum);
+        double flat = flat_nanoseconds_per_node(flattener.ast, repetitions, checksum);
+        std::printf("%-6d %-10ld %-14.2f %-14.2f %-14.2f %.2fx\n", depth, counter.nodes, rtti, tagged,
+                    flat, rtti / flat);
+        total_checksum += checksum;
+    }
+
+    // Printed so the walks cannot be optimised away.
+    std::printf("checksum %ld\n", total_checksum);
+    return 0;
+}
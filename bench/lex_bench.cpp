@@ -0,0 +1,79 @@
+// Measures lexing throughput in MB/s. Scans the script given on the command
+// line, or a generated one, several times and reports the fastest run. The
+// Makefile builds this once with the vectorized scanner and once with
+// IOWA_SCALAR_LEXER so the two can be compared on the same input.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "scanner.h"
+#include "simd.h"
+#include "source.h"
+
+// A mix of the statements real scripts are made of, with indentation, long
+// names and string literals so every scanning path is exercised.
+static std::string generate_script(size_t target_size) {
+    std::string script;
+    script.reserve(target_size + 256);
+    for (long i = 0; script.size() < target_size; i++) {
+        std::string n = std::to_string(i);
+        script += "set counter_" + n + " = " + n + " * 3 + 17;\n";
+        script += "if (counter_" + n + " >= 1000 && running_total < 99999) {\n";
+        script += "    console_out \"iteration number " + n + " is still running\";\n";
+        script += "    set running_total = running_total + counter_" + n + ";\n";
+        script += "} else {\n        set flag = false;\n}\n\n";
+    }
+    return script;
+}
+
+int main(int argc, char* argv[]) {
+    SourceBuffer source = argc > 1 ? SourceBuffer::map_file(argv[1])
+                                   : SourceBuffer::from_string(generate_script(16 << 20));
+    std::string_view text = source.text();
+
+    const int repetitions = 10;
+    double best_lex = 1e30;
+    double best_stream = 1e30;
+    double best_parallel = 1e30;
+    size_t tokens = 0;
+    for (int i = 0; i < repetitions; i++) {
+        // Pulling tokens one at a time measures the scanner alone, building a
+        // TokenStream adds the cost of storing them. The parallel scan splits
+        // large sources across the hardware threads.
+        auto start = std::chrono::steady_clock::now();
+        Lexer lexer(text);
+        size_t pulled = 1;
+        while (lexer.next().kind != TokenType::Eof) {
+            pulled++;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best_lex = std::min(best_lex, elapsed.count());
+
+        start = std::chrono::steady_clock::now();
+        TokenStream stream = scan_source(text, 1);
+        elapsed = std::chrono::steady_clock::now() - start;
+        best_stream = std::min(best_stream, elapsed.count());
+
+        start = std::chrono::steady_clock::now();
+        TokenStream parallel = scan_source(text);
+        elapsed = std::chrono::steady_clock::now() - start;
+        best_parallel = std::min(best_parallel, elapsed.count());
+
+        if (pulled != stream.size() || parallel.size() != stream.size()) {
+            std::fprintf(stderr, "token counts differ: %zu, %zu and %zu\n", pulled, stream.size(),
+                         parallel.size());
+            return 1;
+        }
+        tokens = stream.size();
+    }
+
+    double megabytes = static_cast<double>(text.size()) / (1 << 20);
+    std::printf("%-8s %-10s %-10s %-12s %-12s %-8s %s\n", "lexer", "bytes", "tokens", "lex MB/s",
+                "stream MB/s", "threads", "parallel MB/s");
+    std::printf("%-8s %-10zu %-10zu %-12.1f %-12.1f %-8u %.1f\n", IOWA_SIMD_NAME, text.size(), tokens,
+                megabytes / best_lex, megabytes / best_stream, std::thread::hardware_concurrency(),
+                megabytes / best_parallel);
+}
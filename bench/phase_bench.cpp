@@ -0,0 +1,221 @@
+// Times each phase of the interpreter separately on generated workloads:
+// scanning, parsing, folding, resolving and type checking, running on the tree walker,
+// compiling and running on the VM, and compiling to closures and running
+// them. Every workload is generated at three
+// scales. Results are printed as one JSON object per line so runs from
+// different commits can be compared. With --write=<dir> the generated
+// scripts are also saved as .ia files to run through Iowa directly.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "closure.h"
+#include "compiler.h"
+#include "evaluator.h"
+#include "optimizer.h"
+#include "output.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scanner.h"
+#include "type_checker.h"
+#include "vm.h"
+
+namespace {
+
+struct Workload {
+    const char* name;
+    std::string (*generate)(int scale);
+};
+
+// Long statements of nested + and - around a variable, so constant folding
+// cannot collapse them.
+std::string deep_arithmetic(int scale) {
+    std::string script = "set a = 3;\nset total = 0;\n";
+    for (int statement = 0; statement < 200 * scale; statement++) {
+        std::string expression = "a";
+        for (int depth = 1; depth <= 40; depth++) {
+            expression = "(" + expression + (depth % 2 ? " + " : " - ") + std::to_string(depth) + ")";
+        }
+        script += "set total = total + " + expression + " * 1;\n";
+    }
+    script += "console_out total;\n";
+    return script;
+}
+
+std::string loop_counter(int scale) {
+    std::string limit = std::to_string(20000 * scale);
+    return "set i = 0;\nset sum = 0;\n"
+           "loop (i < " + limit + ") {\n"
+           "    set sum = sum + i / 1000 - 1;\n"
+           "    set i = i + 1;\n"
+           "}\n"
+           "console_out sum;\n";
+}
+
+// Every block reads x before shadowing it, so lookups walk outwards.
+std::string nested_shadowing(int scale) {
+    std::string body;
+    for (int depth = 0; depth < 12; depth++) {
+        body += std::string(depth * 4 + 4, ' ') + "{\n";
+        body += std::string(depth * 4 + 8, ' ') + "set x = x + " + std::to_string(depth) + ";\n";
+    }
+    for (int depth = 11; depth >= 0; depth--) {
+        body += std::string(depth * 4 + 4, ' ') + "}\n";
+    }
+    return "set x = 1;\nset i = 0;\n"
+           "loop (i < " + std::to_string(2000 * scale) + ") {\n" + body +
+           "    set i = i + 1;\n"
+           "}\n"
+           "console_out x;\n";
+}
+
+// Blocks cannot assign outer variables, so the comparisons feed variables of
+// the loop's own scope.
+std::string string_comparison(int scale) {
+    return "set i = 0;\nset name = \"iowa\";\nset other = \"des moines\";\n"
+           "loop (i < " + std::to_string(10000 * scale) + ") {\n"
+           "    set same = name == \"iowa\" && other == \"des moines\";\n"
+           "    set differ = name == other || other == \"iowa\";\n"
+           "    if (same) {\n"
+           "        set last_match = i;\n"
+           "    } else {\n"
+           "        set last_miss = i;\n"
+           "    }\n"
+           "    set i = i + 1;\n"
+           "}\n"
+           "console_out same;\n"
+           "console_out differ;\n";
+}
+
+const Workload workloads[] = {
+    {"deep_arithmetic", deep_arithmetic},
+    {"loop_counter", loop_counter},
+    {"nested_shadowing", nested_shadowing},
+    {"string_comparison", string_comparison},
+};
+
+const struct {
+    const char* name;
+    int factor;
+} scales[] = {{"small", 1}, {"medium", 10}, {"large", 100}};
+
+struct Timings {
+    double scan = 1e30;
+    double parse = 1e30;
+    double resolve = 1e30;
+    double tree = 1e30;
+    double vm = 1e30;
+    double closure = 1e30;
+    size_t tokens = 0;
+    size_t nodes = 0;
+};
+
+template <typename Phase>
+double milliseconds(Phase phase) {
+    auto start = std::chrono::steady_clock::now();
+    phase();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Runs every phase `repetitions` times and keeps the fastest time of each.
+Timings measure(const std::string& source, int repetitions) {
+    Timings best;
+    for (int i = 0; i < repetitions; i++) {
+        TokenStream tokens(source);
+        best.scan = std::min(best.scan, milliseconds([&] { tokens = scan_source(source); }));
+
+        Ast program;
+        best.parse = std::min(best.parse, milliseconds([&] {
+            Parser parser(tokens);
+            program = parser.program();
+        }));
+
+        best.resolve = std::min(best.resolve, milliseconds([&] {
+            Optimizer optimizer;
+            optimizer.fold_constants(program);
+            Resolver resolver;
+            resolver.resolve(program);
+            // The engines rely on the flags the checker sets, as in Iowa.
+            ErrorTracker errors;
+            TypeChecker checker;
+            checker.check(program, errors);
+        }));
+
+        OutputSink output = OutputSink::to_memory();
+        best.tree = std::min(best.tree, milliseconds([&] {
+            Evaluator evaluator(output);
+            evaluator.execute_program(program);
+        }));
+
+        OutputSink vm_output = OutputSink::to_memory();
+        best.vm = std::min(best.vm, milliseconds([&] {
+            Compiler compiler;
+            Chunk chunk = compiler.compile(program);
+            VM vm(vm_output);
+            vm.run(chunk);
+        }));
+
+        OutputSink closure_output = OutputSink::to_memory();
+        best.closure = std::min(best.closure, milliseconds([&] {
+            ClosureCompiler compiler;
+            ClosureProgram compiled = compiler.compile(program);
+            ClosureEngine engine(closure_output);
+            engine.run(compiled);
+        }));
+
+        if (output.captured() != vm_output.captured() ||
+            output.captured() != closure_output.captured()) {
+            std::fprintf(stderr, "the engines printed different output\n");
+            std::exit(1);
+        }
+        best.tokens = tokens.size();
+        best.nodes = program.nodes.size();
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string commit = "unknown";
+    std::string write_directory;
+    int repetitions = 3;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument.starts_with("--commit=")) {
+            commit = argument.substr(9);
+        } else if (argument.starts_with("--write=")) {
+            write_directory = argument.substr(8);
+        } else if (argument.starts_with("--repetitions=")) {
+            repetitions = std::max(1, std::stoi(argument.substr(14)));
+        } else {
+            std::fprintf(stderr, "usage: phase_bench [--commit=id] [--write=dir] [--repetitions=N]\n");
+            return 1;
+        }
+    }
+
+    for (const Workload& workload : workloads) {
+        for (const auto& scale : scales) {
+            std::string source = workload.generate(scale.factor);
+            if (!write_directory.empty()) {
+                std::ofstream(write_directory + "/" + workload.name + "_" + scale.name + ".ia") << source;
+            }
+
+            Timings timings = measure(source, repetitions);
+            std::printf("{\"commit\": \"%s\", \"workload\": \"%s\", \"scale\": \"%s\", "
+                        "\"bytes\": %zu, \"tokens\": %zu, \"nodes\": %zu, "
+                        "\"scan_ms\": %.3f, \"parse_ms\": %.3f, \"resolve_ms\": %.3f, "
+                        "\"tree_ms\": %.3f, \"vm_ms\": %.3f, \"closure_ms\": %.3f}\n",
+                        commit.c_str(), workload.name, scale.name, source.size(), timings.tokens,
+                        timings.nodes, timings.scan, timings.parse, timings.resolve, timings.tree,
+                        timings.vm, timings.closure);
+            std::fflush(stdout);
+        }
+    }
+}
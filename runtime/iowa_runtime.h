@@ -0,0 +1,235 @@
+#ifndef IOWA_RUNTIME_H
+#define IOWA_RUNTIME_H
+
+// Runtime support for the C++ that `Iowa --emit-cpp` writes. It reproduces
+// the interpreter's dynamic values, operators, output and error messages,
+// and is header only so a translated script builds with a single compiler
+// invocation.
+
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace iowa {
+
+// A runtime value. Scripts can only produce integers, booleans and strings.
+// Every string comes from a literal, and the translator emits each distinct
+// literal once, so two strings are equal exactly when their pointers are.
+// Strings carry their length, so a literal may hold NUL bytes.
+class Value {
+public:
+    enum class Type : unsigned char {
+        Undefined,
+        Int,
+        String,
+        Bool
+    };
+
+    constexpr Value() : tag(Type::Undefined), integer(0) {}
+    constexpr Value(int v) : tag(Type::Int), integer(v) {}
+    constexpr Value(bool v) : tag(Type::Bool), boolean(v) {}
+
+    template<typename T>
+    Value(T*) = delete;
+
+    static constexpr Value string(std::string_view v) {
+        Value value;
+        value.tag = Type::String;
+        value.text = v;
+        return value;
+    }
+
+    constexpr Type type() const { return tag; }
+    constexpr bool is_undefined() const { return tag == Type::Undefined; }
+    constexpr bool is_int() const { return tag == Type::Int; }
+    constexpr bool is_bool() const { return tag == Type::Bool; }
+    constexpr bool is_string() const { return tag == Type::String; }
+
+    constexpr int as_int() const { return integer; }
+    constexpr bool as_bool() const { return boolean; }
+    constexpr std::string_view as_string() const { return text; }
+
+private:
+    Type tag;
+    union {
+        int integer;
+        bool boolean;
+        std::string_view text;
+    };
+};
+
+enum class Op {
+    Plus,
+    Minus,
+    Multiply,
+    Divide,
+    GreaterThan,
+    GreaterEqualsThan,
+    LessThan,
+    LessEqualsThan,
+    EqualsEquals,
+    NotEqual,
+    And,
+    Or
+};
+
+// The interpreter's names for the operators, as its error messages use them.
+constexpr const char* op_name(Op op) {
+    constexpr const char* names[] = {
+        "Plus", "Minus", "Multiply", "Divide", "GreaterThan", "GreaterEqualsThan",
+        "LessThan", "LessEqualsThan", "EqualsEquals", "NotEqual", "And", "Or",
+    };
+    return names[static_cast<int>(op)];
+}
+
+[[noreturn]] inline void fail_binary(Op op, Value left, Value right) {
+    std::string name = op_name(op);
+    if (left.type() != right.type()) {
+        throw std::runtime_error("Type mismatch in binary expression: " + name);
+    }
+    switch (left.type()) {
+        case Value::Type::Int:
+            throw std::runtime_error("Unsupported integer op: " + name);
+        case Value::Type::Bool:
+            throw std::runtime_error("Unsupported boolean op: " + name);
+        case Value::Type::String:
+            throw std::runtime_error("Unsupported string op: " + name);
+        default:
+            throw std::runtime_error("Type mismatch in binary expression: " + name);
+    }
+}
+
+// Both operands of a binary operator. Braced initialization evaluates them
+// left to right, as the interpreter does, which function arguments do not.
+struct Operands {
+    Value left;
+    Value right;
+};
+
+// As in the interpreter, +, - and * wrap around in two's complement, and
+// dividing INT_MIN by -1 is an error like dividing by zero.
+template <Op op>
+inline Value binary(Operands operands) {
+    Value left = operands.left;
+    Value right = operands.right;
+    if (left.is_int() && right.is_int()) {
+        unsigned l = static_cast<unsigned>(left.as_int());
+        unsigned r = static_cast<unsigned>(right.as_int());
+        if constexpr (op == Op::Plus) {
+            return static_cast<int>(l + r);
+        } else if constexpr (op == Op::Minus) {
+            return static_cast<int>(l - r);
+        } else if constexpr (op == Op::Multiply) {
+            return static_cast<int>(l * r);
+        } else if constexpr (op == Op::Divide) {
+            if (right.as_int() == 0) {
+                throw std::runtime_error("Division by zero");
+            }
+            if (right.as_int() == -1 && left.as_int() == INT_MIN) {
+                throw std::runtime_error("Integer overflow in division");
+            }
+            return left.as_int() / right.as_int();
+        } else if constexpr (op == Op::GreaterThan) {
+            return left.as_int() > right.as_int();
+        } else if constexpr (op == Op::GreaterEqualsThan) {
+            return left.as_int() >= right.as_int();
+        } else if constexpr (op == Op::LessThan) {
+            return left.as_int() < right.as_int();
+        } else if constexpr (op == Op::LessEqualsThan) {
+            return left.as_int() <= right.as_int();
+        } else if constexpr (op == Op::EqualsEquals) {
+            return left.as_int() == right.as_int();
+        } else if constexpr (op == Op::NotEqual) {
+            return left.as_int() != right.as_int();
+        } else {
+            fail_binary(op, left, right);
+        }
+    }
+
+    if (left.is_bool() && right.is_bool()) {
+        if constexpr (op == Op::And) {
+            return left.as_bool() && right.as_bool();
+        } else if constexpr (op == Op::Or) {
+            return left.as_bool() || right.as_bool();
+        } else if constexpr (op == Op::EqualsEquals) {
+            return left.as_bool() == right.as_bool();
+        } else if constexpr (op == Op::NotEqual) {
+            return left.as_bool() != right.as_bool();
+        }
+    } else if (left.is_string() && right.is_string()) {
+        if constexpr (op == Op::EqualsEquals) {
+            return left.as_string().data() == right.as_string().data();
+        } else if constexpr (op == Op::NotEqual) {
+            return left.as_string().data() != right.as_string().data();
+        }
+    }
+    fail_binary(op, left, right);
+}
+
+inline bool condition(Value value, const char* message) {
+    if (!value.is_bool()) {
+        throw std::runtime_error(message);
+    }
+    return value.as_bool();
+}
+
+inline Value undefined_variable(const char* name) {
+    throw std::runtime_error(std::string("Error: variable '") + name + "' does not exist");
+}
+
+// Output is buffered and written in large blocks, like the interpreter's.
+inline std::string& output() {
+    static std::string buffer;
+    return buffer;
+}
+
+inline void flush() {
+    std::fwrite(output().data(), 1, output().size(), stdout);
+    std::fflush(stdout);
+    output().clear();
+}
+
+inline void print(Value value) {
+    std::string& buffer = output();
+    switch (value.type()) {
+        case Value::Type::Int: {
+            char digits[16];
+            auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value.as_int());
+            buffer.append(digits, end);
+            break;
+        }
+        case Value::Type::String:
+            buffer.append(value.as_string().data(), value.as_string().size());
+            break;
+        case Value::Type::Bool:
+            buffer += value.as_bool() ? "true" : "false";
+            break;
+        case Value::Type::Undefined:
+            break;
+    }
+    buffer += '\n';
+    if (buffer.size() >= (64 << 10)) {
+        flush();
+    }
+}
+
+// Runs a translated script. A runtime error prints what was output so far,
+// then the message on stderr, and exits with status 1.
+inline int run(void (*script)()) {
+    try {
+        script();
+    } catch (const std::exception& error) {
+        flush();
+        std::fprintf(stderr, "%s\n", error.what());
+        return 1;
+    }
+    flush();
+    return 0;
+}
+
+}
+
+#endif
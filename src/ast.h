@@ -1,147 +1,179 @@
 #ifndef EXPRESSIONS_H
 #define EXPRESSIONS_H
 
+#include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <variant>
-#include <memory>
 
-#include "errors.h"
+#include "interner.h"
 #include "token.h"
-
-class Expression {
-public:
-    virtual ~Expression() = default;
+#include "value.h"
+
+using NodeIndex = uint32_t;
+constexpr NodeIndex no_node = UINT32_MAX;
+constexpr uint32_t no_scope = UINT32_MAX;
+
+// Where a variable lives at runtime: how many scopes to walk outwards and
+// the slot inside that scope. A negative slot marks a name that no enclosing
+// scope declares. A definite binding is assigned on every path that reaches it.
+struct Binding {
+    int depth = 0;
+    int slot = -1;
+    bool definite = false;
 };
 
-class Declaration {
-public:
-    virtual ~Declaration() = default;
+// Static layout of a runtime scope. While slot i has not been assigned yet,
+// lookups continue at Ast::shadowed[first_slot + i], which is relative to
+// this scope.
+struct Scope {
+    uint32_t first_slot = 0;
+    uint32_t slot_count = 0;
 };
 
-class Statement : public Declaration{
-public:
-    virtual ~Statement() = default;
+// Where a node starts in the source. Lines and columns count from 1; a node
+// that was not parsed from source is at line 0.
+struct SourcePosition {
+    uint32_t line = 0;
+    uint32_t column = 0;
 };
 
-class DynamicDeclaration : public Declaration {
-public:
-    std::string variable_name;
-    std::unique_ptr<Expression> value;
-
-    DynamicDeclaration(std::string name,
-                       std::unique_ptr<Expression> val)
-        : variable_name(std::move(name)), value(std::move(val)) {}
+enum class NodeKind : uint8_t {
+    Literal,
+    Identifier,
+    Binary,
+
+    DynamicDeclaration,
+    ExpressionStatement,
+    PrintStatement,
+    Block,
+    If,
+    Loop,
+    Program
 };
 
-class Literal : public Expression {
-public:
-    std::string value;
-    TokenType type;
-
-    Literal(std::string val, TokenType t)
-        : value(std::move(val)), type(t) {}
-};
-
-class IdentifierExpr : public Expression {
-public:
-    std::string name;
-
-    IdentifierExpr(std::string n)
-        : name(std::move(n)) {}
-};
-
-class BinaryExpression : public Expression {
-public:
-    std::unique_ptr<Expression> left;
+// Every node has the same 16 byte layout. What the operand fields hold
+// depends on the kind:
+//
+//   Literal              first: constant      op: Number, Boolean or String
+//   Identifier           first: name symbol   second: binding depth
+//                        third: binding slot  flags: definite_binding
+//   Binary               first: left          second: right        op: operator
+//                        flags: int_operands
+//   DynamicDeclaration   first: name symbol   second: value        third: slot
+//   ExpressionStatement  first: expression
+//   PrintStatement       first: expression
+//   Block, Program       first: first child   second: child count  third: scope
+//   If                   first: condition     second: if block     third: else block
+//                        flags: boolean_condition
+//   Loop                 first: condition     second: loop block   flags: boolean_condition
+//
+// Names are symbols in Ast::interner, constants index Ast::constants, child
+// lists live in Ast::children and scopes index Ast::scopes. Absent children
+// are no_node. The parser adds a node's children before the node itself,
+// which fold_constants and prune_branches rely on; hoist_invariants, which
+// runs after them, does not keep to it.
+// Source positions are kept apart in Ast::positions so walking the tree does
+// not pull them into the cache.
+struct Node {
+    NodeKind kind;
     TokenType op;
-    std::unique_ptr<Expression> right;
-
-    BinaryExpression(std::unique_ptr<Expression> l,
-                     TokenType o,
-                     std::unique_ptr<Expression> r)
-        : left(std::move(l)), op(o), right(std::move(r)) {}
+    uint16_t flags;
+    uint32_t first;
+    uint32_t second;
+    uint32_t third;
 };
 
-class Identifier : public Expression{
-public:
-    std::string identifier_name;
-
-    Identifier(std::string name)
-        : identifier_name(std::move(name)) {}
-};
+constexpr uint16_t definite_binding = 1;
+// Set by the TypeChecker where it proved both operands are always ints, or
+// the condition is always a boolean.
+constexpr uint16_t int_operands = 2;
+constexpr uint16_t boolean_condition = 4;
 
-class Assignment : public Statement {
+// Owns a whole program. Nodes refer to each other by index, so the tree is a
+// handful of flat arrays that are allocated in bulk and freed in one go.
+class Ast {
 public:
-    std::unique_ptr<IdentifierExpr> variable;
-    std::unique_ptr<Expression> value;
-
-    Assignment(std::unique_ptr<IdentifierExpr> var,
-               std::unique_ptr<Expression> val)
-        : variable(std::move(var)), value(std::move(val)) {}
-};
+    std::vector<Node> nodes;
+    std::vector<SourcePosition> positions;
+    std::vector<NodeIndex> children;
+    std::vector<Value> constants;
+    Interner interner;
+    std::vector<Scope> scopes;
+    std::vector<Binding> shadowed;
+    NodeIndex root = no_node;
+
+    Ast() = default;
+    // String constants point into this Ast's interner, so a copy would
+    // point into the original. Moving keeps the strings where they are.
+    Ast(const Ast&) = delete;
+    Ast& operator=(const Ast&) = delete;
+    Ast(Ast&&) = default;
+    Ast& operator=(Ast&&) = default;
+
+    NodeIndex add_node(NodeKind kind, TokenType op, uint32_t first,
+                       uint32_t second = no_node, uint32_t third = no_node,
+                       SourcePosition at = {}) {
+        nodes.push_back(Node{kind, op, 0, first, second, third});
+        positions.push_back(at);
+        return static_cast<NodeIndex>(nodes.size() - 1);
+    }
 
-class ExpressionStatement : public Statement {
-public:
-    std::unique_ptr<Expression> expr;
+    uint32_t add_children(std::span<const NodeIndex> list) {
+        uint32_t first = static_cast<uint32_t>(children.size());
+        children.insert(children.end(), list.begin(), list.end());
+        return first;
+    }
 
-    ExpressionStatement(std::unique_ptr<Expression> e)
-        : expr(std::move(e)) {}
-};
+    uint32_t add_constant(Value value) {
+        constants.push_back(value);
+        return static_cast<uint32_t>(constants.size() - 1);
+    }
 
-class Block : public Statement {
-public:
-    std::vector<std::unique_ptr<Declaration>> declarations;
+    uint32_t add_string_constant(std::string_view value) {
+        return add_constant(Value::string(&interner.str(interner.intern(value))));
+    }
 
-    Block(std::vector<std::unique_ptr<Declaration>> stmts)
-        : declarations(std::move(stmts)) {}
-};
+    const Node& node(NodeIndex index) const { return nodes[index]; }
+    Node& node(NodeIndex index) { return nodes[index]; }
+    SourcePosition position(NodeIndex index) const { return positions[index]; }
 
-class IfStatement : public Statement {
-public:
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<Block> if_block;
-    std::unique_ptr<Block> else_block;
-    bool has_else_block;
-
-    IfStatement(std::unique_ptr<Expression> cond,
-                std::unique_ptr<Block> ib,
-                std::unique_ptr<Block> eb)
-        : condition(std::move(cond)),
-          if_block(std::move(ib)),
-          else_block(std::move(eb)) {
-        if (else_block == nullptr){
-            has_else_block = false;
-        } else {
-            has_else_block = true;
-        }
+    std::span<const NodeIndex> block_children(const Node& block) const {
+        return {children.data() + block.first, block.second};
     }
-};
 
-class LoopStatement : public Statement{
-public:
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<Block> loop_block;
-
-    LoopStatement(std::unique_ptr<Expression> cond,
-                  std::unique_ptr<Block> lb)
-        : condition(std::move(cond)), loop_block(std::move(lb)) {}
-};
+    std::string_view name(Symbol symbol) const {
+        return interner.view(symbol);
+    }
 
-class PrintStatement : public Statement {
-public:
-    std::unique_ptr<Expression> expression;
+    std::span<const Binding> scope_slots(uint32_t scope) const {
+        const Scope& layout = scopes[scope];
+        return {shadowed.data() + layout.first_slot, layout.slot_count};
+    }
 
-    PrintStatement(std::unique_ptr<Expression> expr)
-        : expression(std::move(expr)) {}
-};
+    Binding binding(const Node& identifier) const {
+        return Binding{static_cast<int>(identifier.second), static_cast<int>(identifier.third),
+                       (identifier.flags & definite_binding) != 0};
+    }
 
-class Program : public Declaration{
-public:
-    std::vector<std::unique_ptr<Declaration>> declarations;
+    void set_binding(Node& identifier, Binding binding) {
+        identifier.second = static_cast<uint32_t>(binding.depth);
+        identifier.third = static_cast<uint32_t>(binding.slot);
+        identifier.flags = binding.definite ? definite_binding : 0;
+    }
 
-    Program(std::vector<std::unique_ptr<Declaration>> decls)
-        : declarations(std::move(decls)) {}
+    // Forgets everything but the interner and the layout of the global scope,
+    // once a streamed top-level declaration has run. Values never point into
+    // the constants, only into the interner, so variables stay valid.
+    void release_declarations() {
+        nodes.clear();
+        positions.clear();
+        children.clear();
+        constants.clear();
+        scopes.resize(1);
+        shadowed.resize(scopes[0].slot_count);
+    }
 };
 
 #endif // EXPRESSIONS_H
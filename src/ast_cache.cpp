@@ -0,0 +1,300 @@
+#include "ast_cache.h"
+#include "source.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+constexpr char magic[8] = {'I', 'o', 'w', 'a', 'A', 's', 't', '\0'};
+// Entries hold the result of every pass, so bump this whenever the file
+// layout changes, or Ast, Node, Binding, Scope, NodeKind, TokenType or the
+// node flags change, or the optimizer, resolver or type checker start to
+// produce a different tree for the same source.
+// 2: type errors are only rejected in code certain to run.
+constexpr uint32_t format_version = 2;
+// Also keeps apart entries written by different builds of this file, as a
+// safety net for changes that forgot the bump above. It only changes when
+// this file is recompiled, so it cannot replace the bump.
+constexpr std::string_view build_stamp = __DATE__ " " __TIME__;
+
+struct Header {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t optimization_level;
+    uint64_t build;
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint64_t payload_hash;
+    uint32_t root;
+    uint32_t node_count;
+    uint32_t child_count;
+    uint32_t constant_count;
+    uint32_t scope_count;
+    uint32_t shadowed_count;
+    uint32_t string_count;
+    uint32_t string_bytes;
+};
+
+// Values point at interned text, so string constants are stored as the
+// symbol of their text instead.
+struct Constant {
+    Value::Type type;
+    uint32_t symbol;
+    int64_t payload;
+};
+
+static_assert(std::is_trivially_copyable_v<Node>);
+static_assert(std::is_trivially_copyable_v<Binding>);
+
+// Eight bytes at a time; only has to tell scripts apart and catch damaged
+// entries, not resist anyone crafting collisions.
+uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    size_t offset = 0;
+    for (; offset + 8 <= size; offset += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + offset, 8);
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15;
+        hash ^= hash >> 29;
+    }
+    for (; offset < size; offset++) {
+        hash = (hash ^ bytes[offset]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+uint64_t build_hash() {
+    return hash_bytes(build_stamp.data(), build_stamp.size(), format_version);
+}
+
+std::string entry_path(const std::string& directory, uint64_t source_hash, int optimization_level) {
+    char name[40];
+    std::snprintf(name, sizeof(name), "%016llx-O%d.iast",
+                  static_cast<unsigned long long>(source_hash ^ build_hash()), optimization_level);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+// Sections start on eight byte boundaries so they can be read in place
+// from the mapping.
+template <typename T>
+void append(std::string& payload, std::span<const T> items) {
+    payload.append(reinterpret_cast<const char*>(items.data()), items.size_bytes());
+    payload.resize((payload.size() + 7) & ~size_t(7), '\0');
+}
+
+// Walks the sections of a mapped payload, refusing to read past its end.
+class Reader {
+public:
+    explicit Reader(std::string_view payload) : payload(payload) {}
+
+    template <typename T>
+    bool take(std::vector<T>& items, size_t count) {
+        size_t size = count * sizeof(T);
+        if (size > payload.size() - offset) {
+            return false;
+        }
+        const T* first = reinterpret_cast<const T*>(payload.data() + offset);
+        items.assign(first, first + count);
+        offset = std::min(payload.size(), (offset + size + 7) & ~size_t(7));
+        return true;
+    }
+
+private:
+    std::string_view payload;
+    size_t offset = 0;
+};
+
+std::string encode(const Ast& program) {
+    std::unordered_map<const std::string*, uint32_t> symbols;
+    std::vector<uint32_t> string_ends;
+    std::string text;
+    for (Symbol symbol = 0; symbol < program.interner.size(); symbol++) {
+        symbols.emplace(&program.interner.str(symbol), symbol);
+        text += program.interner.view(symbol);
+        string_ends.push_back(static_cast<uint32_t>(text.size()));
+    }
+
+    std::vector<Constant> constants;
+    for (const Value& value : program.constants) {
+        Constant constant{value.type(), 0, 0};
+        if (value.is_string()) {
+            constant.symbol = symbols.at(&value.as_string());
+        } else if (value.is_int()) {
+            constant.payload = value.as_int();
+        } else if (value.is_bool()) {
+            constant.payload = value.as_bool();
+        } else if (value.type() == Value::Type::Double) {
+            double real = value.as_double();
+            std::memcpy(&constant.payload, &real, sizeof(real));
+        }
+        constants.push_back(constant);
+    }
+
+    std::string payload;
+    append<Node>(payload, program.nodes);
+    append<SourcePosition>(payload, program.positions);
+    append<NodeIndex>(payload, program.children);
+    append<Constant>(payload, constants);
+    append<Scope>(payload, program.scopes);
+    append<Binding>(payload, program.shadowed);
+    append<uint32_t>(payload, string_ends);
+    append<char>(payload, text);
+    return payload;
+}
+
+bool decode(const Header& header, std::string_view payload, Ast& program) {
+    Reader reader(payload);
+    std::vector<Constant> constants;
+    std::vector<uint32_t> string_ends;
+    std::vector<char> text;
+    if (!reader.take(program.nodes, header.node_count) ||
+        !reader.take(program.positions, header.node_count) ||
+        !reader.take(program.children, header.child_count) ||
+        !reader.take(constants, header.constant_count) ||
+        !reader.take(program.scopes, header.scope_count) ||
+        !reader.take(program.shadowed, header.shadowed_count) ||
+        !reader.take(string_ends, header.string_count) ||
+        !reader.take(text, header.string_bytes)) {
+        return false;
+    }
+
+    uint32_t start = 0;
+    for (Symbol symbol = 0; symbol < header.string_count; symbol++) {
+        uint32_t end = string_ends[symbol];
+        if (end < start || end > text.size() ||
+            program.interner.intern({text.data() + start, end - start}) != symbol) {
+            return false;
+        }
+        start = end;
+    }
+
+    for (const Constant& constant : constants) {
+        switch (constant.type) {
+            case Value::Type::Int:
+                program.constants.push_back(Value(static_cast<int>(constant.payload)));
+                break;
+            case Value::Type::Bool:
+                program.constants.push_back(Value(constant.payload != 0));
+                break;
+            case Value::Type::Double: {
+                double real;
+                std::memcpy(&real, &constant.payload, sizeof(real));
+                program.constants.push_back(Value(real));
+                break;
+            }
+            case Value::Type::String:
+                if (constant.symbol >= program.interner.size()) {
+                    return false;
+                }
+                program.constants.push_back(Value::string(&program.interner.str(constant.symbol)));
+                break;
+            default:
+                program.constants.push_back(Value());
+                break;
+        }
+    }
+
+    program.root = header.root;
+    return program.root < program.nodes.size();
+}
+
+}
+
+std::optional<Ast> load_cached_ast(const std::string& directory, std::string_view source,
+                                   int optimization_level) {
+    uint64_t source_hash = hash_bytes(source.data(), source.size());
+    std::string path = entry_path(directory, source_hash, optimization_level);
+    if (access(path.c_str(), R_OK) != 0) {
+        return std::nullopt;
+    }
+
+    try {
+        SourceBuffer entry = SourceBuffer::map_file(path.c_str());
+        std::string_view bytes = entry.text();
+        Header header;
+        if (bytes.size() < sizeof(header)) {
+            return std::nullopt;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        std::string_view payload = bytes.substr(sizeof(header));
+
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+            header.format_version != format_version ||
+            header.build != build_hash() ||
+            header.optimization_level != static_cast<uint32_t>(optimization_level) ||
+            header.source_hash != source_hash ||
+            header.source_size != source.size() ||
+            header.payload_hash != hash_bytes(payload.data(), payload.size())) {
+            return std::nullopt;
+        }
+
+        Ast program;
+        if (!decode(header, payload, program)) {
+            return std::nullopt;
+        }
+        return program;
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+void store_cached_ast(const std::string& directory, std::string_view source,
+                      int optimization_level, const Ast& program) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    uint64_t source_hash = hash_bytes(source.data(), source.size());
+    std::string payload = encode(program);
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.format_version = format_version;
+    header.optimization_level = static_cast<uint32_t>(optimization_level);
+    header.build = build_hash();
+    header.source_hash = source_hash;
+    header.source_size = source.size();
+    header.payload_hash = hash_bytes(payload.data(), payload.size());
+    header.root = program.root;
+    header.node_count = static_cast<uint32_t>(program.nodes.size());
+    header.child_count = static_cast<uint32_t>(program.children.size());
+    header.constant_count = static_cast<uint32_t>(program.constants.size());
+    header.scope_count = static_cast<uint32_t>(program.scopes.size());
+    header.shadowed_count = static_cast<uint32_t>(program.shadowed.size());
+    header.string_count = static_cast<uint32_t>(program.interner.size());
+    header.string_bytes = 0;
+    for (Symbol symbol = 0; symbol < program.interner.size(); symbol++) {
+        header.string_bytes += static_cast<uint32_t>(program.interner.view(symbol).size());
+    }
+
+    // Scripts in a batch may share an entry, so every writer has a
+    // temporary file of its own.
+    std::string path = entry_path(directory, source_hash, optimization_level);
+    std::string temporary = path + "." + std::to_string(getpid()) + "." +
+                            std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+                            ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!file) {
+            file.close();
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+    }
+}
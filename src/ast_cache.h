@@ -0,0 +1,28 @@
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ast.h"
+
+// Keeps finished programs (parsed, optimized, resolved and type checked) in
+// a directory, one file per script, so a script that has not changed since
+// its last run goes straight to running. Entries are named after a hash of
+// the source, the optimization level and the interpreter build, and hold
+// the Ast's arrays as they are laid out in memory.
+
+// Returns the program cached for `source`, or nothing when there is no
+// entry or the entry is stale, truncated or corrupt. Never throws for a
+// bad entry; the caller just prepares the program again.
+std::optional<Ast> load_cached_ast(const std::string& directory, std::string_view source,
+                                   int optimization_level);
+
+// Writes the entry for `source`, replacing any old one in a single rename
+// so concurrent runs never see half an entry. A directory that cannot be
+// written is skipped silently.
+void store_cached_ast(const std::string& directory, std::string_view source,
+                      int optimization_level, const Ast& program);
+
+#endif
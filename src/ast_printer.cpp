@@ -0,0 +1,84 @@
+#include "ast_printer.h"
+#include <string>
+
+namespace {
+
+void print_node(const Ast& ast, NodeIndex index, int depth, OutputSink& output);
+
+void print_children(const Ast& ast, const Node& block, int depth, OutputSink& output) {
+    for (NodeIndex child : ast.block_children(block)) {
+        print_node(ast, child, depth, output);
+    }
+}
+
+void print_node(const Ast& ast, NodeIndex index, int depth, OutputSink& output) {
+    output.write(std::string(2 * depth, ' '));
+    if (index == no_node) {
+        output.write("<none>\n");
+        return;
+    }
+
+    const Node& node = ast.node(index);
+    switch (node.kind) {
+        case NodeKind::Literal: {
+            const Value& constant = ast.constants[node.first];
+            output.write("Literal ");
+            if (constant.is_string()) {
+                output.put('"');
+                output.write(constant.as_string());
+                output.put('"');
+                output.put('\n');
+            } else {
+                output.print_value(constant);
+            }
+            break;
+        }
+        case NodeKind::Identifier:
+            output.write("Identifier ");
+            output.write(ast.name(node.first));
+            output.put('\n');
+            break;
+        case NodeKind::Binary:
+            output.write("Binary ");
+            output.write(Token::get_type_string(node.op));
+            output.write(node.flags & int_operands ? " int\n" : "\n");
+            print_node(ast, node.first, depth + 1, output);
+            print_node(ast, node.second, depth + 1, output);
+            break;
+        case NodeKind::DynamicDeclaration:
+            output.write("Set ");
+            output.write(ast.name(node.first));
+            output.put('\n');
+            print_node(ast, node.second, depth + 1, output);
+            break;
+        case NodeKind::ExpressionStatement:
+            output.write("Expression\n");
+            print_node(ast, node.first, depth + 1, output);
+            break;
+        case NodeKind::PrintStatement:
+            output.write("Print\n");
+            print_node(ast, node.first, depth + 1, output);
+            break;
+        case NodeKind::Block:
+        case NodeKind::Program:
+            output.write(node.kind == NodeKind::Block ? "Block\n" : "Program\n");
+            print_children(ast, node, depth + 1, output);
+            break;
+        case NodeKind::If:
+        case NodeKind::Loop:
+            output.write(node.kind == NodeKind::If ? "If" : "Loop");
+            output.write(node.flags & boolean_condition ? " bool\n" : "\n");
+            print_node(ast, node.first, depth + 1, output);
+            print_node(ast, node.second, depth + 1, output);
+            if (node.kind == NodeKind::If && node.third != no_node) {
+                print_node(ast, node.third, depth + 1, output);
+            }
+            break;
+    }
+}
+
+}
+
+void print_ast(const Ast& ast, OutputSink& output) {
+    print_node(ast, ast.root, 0, output);
+}
@@ -0,0 +1,12 @@
+#ifndef AST_PRINTER_H
+#define AST_PRINTER_H
+
+#include "ast.h"
+#include "output.h"
+
+// Writes a program as an indented tree, one node per line, with the flags
+// the type checker set: `int` on Binary nodes proven to add ints, `bool` on
+// conditions proven boolean.
+void print_ast(const Ast& ast, OutputSink& output);
+
+#endif
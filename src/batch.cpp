@@ -0,0 +1,105 @@
+#include "batch.h"
+#include "source.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+struct ScriptResult {
+    std::string output;
+    std::string error;
+    bool failed = false;
+    bool done = false;
+};
+
+}
+
+static void run_script(const std::string& path, const RunOptions& options, ScriptResult& result) {
+    OutputSink output = OutputSink::to_memory();
+    try {
+        SourceBuffer source = SourceBuffer::map_file(path.c_str());
+        run_source(source.text(), options, output);
+    } catch (const std::exception& error) {
+        result.failed = true;
+        result.error = error.what();
+    }
+    result.output = output.take();
+}
+
+int run_batch(const std::vector<std::string>& paths, const RunOptions& options, unsigned jobs,
+              OutputSink& output) {
+    std::vector<ScriptResult> results(paths.size());
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::atomic<size_t> next{0};
+
+    // The pool already keeps every core busy, so each script scans on the
+    // worker that runs it.
+    RunOptions script_options = options;
+    script_options.scan_workers = 1;
+
+    auto work = [&] {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            ScriptResult result;
+            run_script(paths[i], script_options, result);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                results[i] = std::move(result);
+                results[i].done = true;
+            }
+            finished.notify_all();
+        }
+    };
+
+    jobs = static_cast<unsigned>(std::min<size_t>(std::max(jobs, 1u), paths.size()));
+    std::vector<std::thread> workers;
+    workers.reserve(jobs);
+    for (unsigned i = 0; i < jobs; i++) {
+        workers.emplace_back(work);
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        ScriptResult result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] { return results[i].done; });
+            result = std::move(results[i]);
+        }
+        output.write(result.output);
+        if (result.failed) {
+            // Keeps the error next to the output of the script that failed.
+            output.flush();
+            std::cerr << paths[i] << ": error: " << result.error << "\n";
+            status = 1;
+        } else {
+            std::cerr << paths[i] << ": ok\n";
+        }
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return status;
+}
+
+std::vector<std::string> read_manifest(const char* path) {
+    std::ifstream manifest(path);
+    if (!manifest) {
+        throw std::runtime_error("ERROR: manifest could not be opened");
+    }
+    std::vector<std::string> paths;
+    for (std::string line; std::getline(manifest, line);) {
+        if (!line.empty()) {
+            paths.push_back(line);
+        }
+    }
+    return paths;
+}
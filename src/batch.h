@@ -0,0 +1,20 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "runner.h"
+
+// Runs independent scripts on a pool of `jobs` worker threads. Each script
+// gets its own interpreter and its output is captured, then written to
+// `output` in the order the scripts were given, as soon as every script
+// before it has finished. One status line per script goes to stderr. Returns 0 when
+// every script succeeded and 1 otherwise.
+int run_batch(const std::vector<std::string>& paths, const RunOptions& options, unsigned jobs,
+              OutputSink& output);
+
+// Reads a manifest listing one script path per line. Blank lines are skipped.
+std::vector<std::string> read_manifest(const char* path);
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "value.h"
+
+enum class OpCode : uint8_t {
+    Constant,           // operand: constant index
+    GetVariable,        // operand: variable index
+    GetLocal,           // operands: slot, depth; the binding is definite
+    SetLocal,           // operand: slot in the current scope, pops the value
+    UndefinedVariable,  // operand: variable index, always fails
+
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Greater,
+    GreaterEqual,
+    Less,
+    LessEqual,
+    Equal,
+    NotEqual,
+    And,
+    Or,
+
+    // Both operands are known to be ints.
+    AddInt,
+    SubtractInt,
+    MultiplyInt,
+    DivideInt,
+    GreaterInt,
+    GreaterEqualInt,
+    LessInt,
+    LessEqualInt,
+    EqualInt,
+    NotEqualInt,
+
+    // The left operand is known to be an int and the right one is an int
+    // constant. In the same order as the ops above. operand: constant index
+    AddIntConstant,
+    SubtractIntConstant,
+    MultiplyIntConstant,
+    DivideIntConstant,
+    GreaterIntConstant,
+    GreaterEqualIntConstant,
+    LessIntConstant,
+    LessEqualIntConstant,
+    EqualIntConstant,
+    NotEqualIntConstant,
+
+    Print,
+    Pop,
+    PushScope,          // operand: scope index
+    PopScope,
+
+    Jump,               // operand: absolute target
+    JumpIfFalse,        // operand: absolute target, pops a boolean condition
+    CheckLoopCondition, // leaves the condition on the stack, fails unless boolean
+    LoopIfTrue,         // operand: absolute target, pops the loop condition
+
+    Halt
+};
+
+struct VariableRef {
+    Binding binding;
+    std::string name;
+};
+
+// A compiled program: a flat instruction stream with 32-bit little endian
+// operands, plus the constants, variable references and scope layouts it
+// refers to. The constants and scope layouts are the Ast's own, so the Ast
+// the chunk was compiled from must outlive it.
+struct Chunk {
+    std::vector<uint8_t> code;
+    std::span<const Value> constants;
+    std::vector<VariableRef> variables;
+    std::span<const Scope> scopes;
+    std::span<const Binding> shadowed;
+    uint32_t global_scope = 0;
+    // The most values the code ever has on the stack at once.
+    uint32_t max_stack = 0;
+
+    std::span<const Binding> scope_slots(uint32_t scope) const {
+        const Scope& layout = scopes[scope];
+        return {shadowed.data() + layout.first_slot, layout.slot_count};
+    }
+
+    static uint32_t read_operand(const uint8_t* at) {
+        uint32_t operand;
+        std::memcpy(&operand, at, sizeof(operand));
+        return operand;
+    }
+};
+
+#endif
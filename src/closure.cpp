@@ -0,0 +1,253 @@
+#include "closure.h"
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Calls `build` with the operator as a template argument, so the closure it
+// builds has binary_operation's switch folded down to a single case.
+// Operators binary_operation has no case for return an empty closure.
+template <typename Build>
+CompiledExpression for_operator(TokenType op, Build&& build) {
+    switch (op) {
+        case TokenType::Plus:              return build.template operator()<TokenType::Plus>();
+        case TokenType::Minus:             return build.template operator()<TokenType::Minus>();
+        case TokenType::Multiply:          return build.template operator()<TokenType::Multiply>();
+        case TokenType::Divide:            return build.template operator()<TokenType::Divide>();
+        case TokenType::GreaterThan:       return build.template operator()<TokenType::GreaterThan>();
+        case TokenType::GreaterEqualsThan: return build.template operator()<TokenType::GreaterEqualsThan>();
+        case TokenType::LessThan:          return build.template operator()<TokenType::LessThan>();
+        case TokenType::LessEqualsThan:    return build.template operator()<TokenType::LessEqualsThan>();
+        case TokenType::EqualsEquals:      return build.template operator()<TokenType::EqualsEquals>();
+        case TokenType::NotEqual:          return build.template operator()<TokenType::NotEqual>();
+        case TokenType::And:               return build.template operator()<TokenType::And>();
+        case TokenType::Or:                return build.template operator()<TokenType::Or>();
+        default:                           return nullptr;
+    }
+}
+
+void run_all(const std::vector<CompiledStatement>& statements, ClosureState& state) {
+    for (const CompiledStatement& statement : statements) {
+        statement(state);
+    }
+}
+
+}
+
+ClosureProgram ClosureCompiler::compile(const Ast& program) {
+    ast = &program;
+    const Node& root = ast->node(ast->root);
+
+    std::vector<CompiledStatement> body;
+    for (NodeIndex declaration : ast->block_children(root)) {
+        body.push_back(compile_declaration(declaration));
+    }
+
+    return ClosureProgram{
+        [body = std::move(body)](ClosureState& state) { run_all(body, state); },
+        ast->scope_slots(root.third),
+    };
+}
+
+// Every closure counts itself as one step, the way the tree walker counts
+// each declaration and expression it evaluates.
+CompiledStatement ClosureCompiler::compile_declaration(NodeIndex index) {
+    if (index == no_node) {
+        throw std::runtime_error("null declaration encountered during compilation");
+    }
+
+    const Node& declaration = ast->node(index);
+    if (declaration.kind != NodeKind::DynamicDeclaration) {
+        return compile_statement(declaration);
+    }
+
+    int slot = static_cast<int>(declaration.third);
+    return [value = compile_expression(declaration.second), slot](ClosureState& state) {
+        state.stats.steps++;
+        state.environment.add_variable(slot, value(state));
+    };
+}
+
+CompiledStatement ClosureCompiler::compile_statement(const Node& declaration) {
+    switch (declaration.kind) {
+        case NodeKind::PrintStatement:
+            return [value = compile_expression(declaration.first)](ClosureState& state) {
+                state.stats.steps++;
+                state.output.print_value(value(state));
+            };
+        case NodeKind::ExpressionStatement:
+            return [value = compile_expression(declaration.first)](ClosureState& state) {
+                state.stats.steps++;
+                value(state);
+            };
+        case NodeKind::Block:
+            return [block = compile_block(declaration, true)](ClosureState& state) {
+                state.stats.steps++;
+                block(state);
+            };
+        case NodeKind::If:
+            return compile_if(declaration);
+        case NodeKind::Loop:
+            return compile_loop(declaration);
+        default:
+            throw std::runtime_error("Unknown statement type");
+    }
+}
+
+CompiledStatement ClosureCompiler::compile_block(const Node& block, bool use_new_scope) {
+    std::vector<CompiledStatement> body;
+    for (NodeIndex declaration : ast->block_children(block)) {
+        body.push_back(compile_declaration(declaration));
+    }
+
+    if (!use_new_scope) {
+        return [body = std::move(body)](ClosureState& state) { run_all(body, state); };
+    }
+
+    std::span<const Binding> slots = ast->scope_slots(block.third);
+    return [body = std::move(body), slots](ClosureState& state) {
+        state.environment.enter(slots);
+        run_all(body, state);
+        state.environment.leave();
+    };
+}
+
+CompiledStatement ClosureCompiler::compile_if(const Node& if_stmnt) {
+    CompiledExpression condition = compile_expression(if_stmnt.first);
+    CompiledStatement then_block = compile_block(ast->node(if_stmnt.second), true);
+    CompiledStatement else_block = if_stmnt.third != no_node
+        ? compile_block(ast->node(if_stmnt.third), true)
+        : [](ClosureState&) {};
+
+    return [condition = std::move(condition), then_block = std::move(then_block),
+            else_block = std::move(else_block)](ClosureState& state) {
+        state.stats.steps++;
+        Value value = condition(state);
+        if (!value.is_bool()) {
+            throw std::runtime_error("If condition must be boolean");
+        }
+        if (value.as_bool()) {
+            then_block(state);
+        } else {
+            else_block(state);
+        }
+    };
+}
+
+// The body runs once more after the condition turns false, as in the tree
+// walker.
+CompiledStatement ClosureCompiler::compile_loop(const Node& loop) {
+    CompiledExpression condition = compile_expression(loop.first);
+    CompiledStatement body = compile_block(ast->node(loop.second), false);
+
+    return [condition = std::move(condition), body = std::move(body)](ClosureState& state) {
+        state.stats.steps++;
+        bool condition_value = true;
+        while (condition_value) {
+            Value value = condition(state);
+            if (!value.is_bool()) {
+                throw std::runtime_error("Loop condition must be boolean");
+            }
+            condition_value = value.as_bool();
+            body(state);
+        }
+    };
+}
+
+CompiledExpression ClosureCompiler::compile_expression(NodeIndex index) {
+    if (index == no_node) {
+        throw std::runtime_error("Null expression encountered during compilation");
+    }
+
+    const Node& expr = ast->node(index);
+    switch (expr.kind) {
+        case NodeKind::Binary:
+            return compile_binary(expr);
+        case NodeKind::Identifier:
+            return compile_identifier(expr);
+        case NodeKind::Literal:
+            return [constant = ast->constants[expr.first]](ClosureState& state) {
+                state.stats.steps++;
+                return constant;
+            };
+        default:
+            throw std::runtime_error("Unknown expression type");
+    }
+}
+
+// A literal on the right, as in `i < 100` or `i + 1`, is folded into the
+// operator's closure instead of getting one of its own.
+CompiledExpression ClosureCompiler::compile_binary(const Node& binary) {
+    CompiledExpression left = compile_expression(binary.first);
+    CompiledExpression compiled;
+
+    if (binary.second != no_node && ast->node(binary.second).kind == NodeKind::Literal) {
+        Value constant = ast->constants[ast->node(binary.second).first];
+        compiled = for_operator(binary.op, [&]<TokenType op>() -> CompiledExpression {
+            return [left = std::move(left), constant](ClosureState& state) {
+                state.stats.steps += 2;
+                return binary_operation(op, left(state), constant);
+            };
+        });
+        if (compiled) {
+            return compiled;
+        }
+    }
+
+    CompiledExpression right = compile_expression(binary.second);
+    compiled = for_operator(binary.op, [&]<TokenType op>() -> CompiledExpression {
+        return [left = std::move(left), right = std::move(right)](ClosureState& state) {
+            state.stats.steps++;
+            Value left_value = left(state);
+            Value right_value = right(state);
+            return binary_operation(op, left_value, right_value);
+        };
+    });
+    if (compiled) {
+        return compiled;
+    }
+
+    // Operators without a case of their own fail inside binary_operation,
+    // with the same message the tree walker gives.
+    return [left = std::move(left), right = std::move(right), op = binary.op](ClosureState& state) {
+        state.stats.steps++;
+        Value left_value = left(state);
+        Value right_value = right(state);
+        return binary_operation(op, left_value, right_value);
+    };
+}
+
+CompiledExpression ClosureCompiler::compile_identifier(const Node& identifier) {
+    Binding binding = ast->binding(identifier);
+    const std::string* name = &ast->interner.str(identifier.first);
+
+    return [binding, name](ClosureState& state) {
+        state.stats.steps++;
+        state.stats.lookups++;
+        const Value* value = binding.slot < 0
+            ? nullptr
+            : state.environment.get_variable_value(binding);
+        if (!value) {
+            throw std::runtime_error("Error: variable '" + *name + "' does not exist");
+        }
+        return *value;
+    };
+}
+
+ClosureEngine::ClosureEngine(OutputSink& output, Allocation allocation)
+    : output(output), memory(allocation) {}
+
+void ClosureEngine::run(const ClosureProgram& program) {
+    Environment environment(memory.resource());
+    environment.reset(program.globals);
+    ClosureState state{output, environment, {}};
+    try {
+        program.body(state);
+    } catch (...) {
+        stats = state.stats;
+        throw;
+    }
+    stats = state.stats;
+}
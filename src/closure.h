@@ -0,0 +1,69 @@
+#ifndef CLOSURE_H
+#define CLOSURE_H
+
+#include <functional>
+#include <span>
+
+#include "ast.h"
+#include "environment.h"
+#include "memory.h"
+#include "output.h"
+#include "profile.h"
+#include "value.h"
+
+// What compiled closures run against: the scopes being run, where printed
+// values go and the execution counts.
+struct ClosureState {
+    OutputSink& output;
+    Environment& environment;
+    ExecutionStats stats;
+};
+
+using CompiledExpression = std::function<Value(ClosureState&)>;
+using CompiledStatement = std::function<void(ClosureState&)>;
+
+// A program compiled into one closure per node. The closures refer to the
+// Ast's scopes and interned names, so the Ast must outlive it.
+struct ClosureProgram {
+    CompiledStatement body;
+    std::span<const Binding> globals;
+};
+
+// Compiles an Ast once into nested closures. Every node is looked at a
+// single time: operators, bindings and constants are baked into the closure
+// built for it, so running the program never switches on node kinds.
+class ClosureCompiler {
+public:
+    ClosureProgram compile(const Ast& program);
+
+private:
+    CompiledStatement compile_declaration(NodeIndex declaration);
+    CompiledStatement compile_statement(const Node& declaration);
+    CompiledStatement compile_block(const Node& block, bool use_new_scope);
+    CompiledStatement compile_if(const Node& if_stmnt);
+    CompiledStatement compile_loop(const Node& loop);
+
+    CompiledExpression compile_expression(NodeIndex expr);
+    CompiledExpression compile_binary(const Node& binary);
+    CompiledExpression compile_identifier(const Node& identifier);
+
+    const Ast* ast = nullptr;
+};
+
+class ClosureEngine {
+public:
+    // Whatever the program prints goes to `output`. Scopes are allocated as
+    // `allocation` says.
+    explicit ClosureEngine(OutputSink& output, Allocation allocation = Allocation::Global);
+
+    void run(const ClosureProgram& program);
+
+    const ExecutionStats& statistics() const { return stats; }
+
+private:
+    OutputSink& output;
+    RuntimeMemory memory;
+    ExecutionStats stats;
+};
+
+#endif
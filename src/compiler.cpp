@@ -0,0 +1,256 @@
+#include "compiler.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+Chunk Compiler::compile(const Ast& program) {
+    ast = &program;
+    chunk = Chunk{};
+    stack_depth = 0;
+    code_size = 0;
+    chunk.constants = program.constants;
+    chunk.scopes = program.scopes;
+    chunk.shadowed = program.shadowed;
+
+    // Most nodes become one instruction with one operand.
+    chunk.code.resize(program.nodes.size() * (1 + sizeof(uint32_t)) + 1);
+
+    const Node& root = ast->node(ast->root);
+    chunk.global_scope = root.third;
+    for (NodeIndex declaration : ast->block_children(root)) {
+        compile_declaration(declaration);
+    }
+    emit_op(OpCode::Halt);
+
+    chunk.code.resize(code_size);
+    return std::move(chunk);
+}
+
+void Compiler::compile_declaration(NodeIndex index) {
+    if (index == no_node) {
+        throw std::runtime_error("null declaration encountered during compilation");
+    }
+
+    const Node& declaration = ast->node(index);
+    if (declaration.kind == NodeKind::DynamicDeclaration) {
+        compile_dynamic_declaration(declaration);
+    } else {
+        compile_statement(declaration);
+    }
+}
+
+void Compiler::compile_statement(const Node& declaration) {
+    switch (declaration.kind) {
+        case NodeKind::PrintStatement:
+            compile_expression(declaration.first);
+            emit_op(OpCode::Print);
+            stack_depth--;
+            break;
+        case NodeKind::ExpressionStatement:
+            compile_expression(declaration.first);
+            emit_op(OpCode::Pop);
+            stack_depth--;
+            break;
+        case NodeKind::Block:
+            compile_block(declaration, true);
+            break;
+        case NodeKind::If:
+            compile_if(declaration);
+            break;
+        case NodeKind::Loop:
+            compile_loop(declaration);
+            break;
+        default:
+            throw std::runtime_error("Unknown statement type");
+    }
+}
+
+void Compiler::compile_dynamic_declaration(const Node& declaration) {
+    compile_expression(declaration.second);
+    emit_op(OpCode::SetLocal, declaration.third);
+    stack_depth--;
+}
+
+void Compiler::compile_block(const Node& block, bool use_new_scope) {
+    if (use_new_scope) {
+        emit_op(OpCode::PushScope, block.third);
+    }
+    for (NodeIndex declaration : ast->block_children(block)) {
+        compile_declaration(declaration);
+    }
+    if (use_new_scope) {
+        emit_op(OpCode::PopScope);
+    }
+}
+
+void Compiler::compile_if(const Node& if_stmnt) {
+    compile_expression(if_stmnt.first);
+    size_t else_jump = emit_jump(OpCode::JumpIfFalse);
+    stack_depth--;
+    compile_block(ast->node(if_stmnt.second), true);
+
+    if (if_stmnt.third != no_node) {
+        size_t end_jump = emit_jump(OpCode::Jump);
+        patch_jump(else_jump);
+        compile_block(ast->node(if_stmnt.third), true);
+        patch_jump(end_jump);
+    } else {
+        patch_jump(else_jump);
+    }
+}
+
+// The tree walker evaluates the condition, runs the body and only then acts
+// on the condition, so the body always runs once more after the condition
+// turns false. The condition therefore stays on the stack across the body.
+void Compiler::compile_loop(const Node& loop) {
+    uint32_t loop_start = static_cast<uint32_t>(code_size);
+    compile_expression(loop.first);
+    if (!(loop.flags & boolean_condition)) {
+        emit_op(OpCode::CheckLoopCondition);
+    }
+    compile_block(ast->node(loop.second), false);
+    emit_op(OpCode::LoopIfTrue, loop_start);
+    stack_depth--;
+}
+
+void Compiler::compile_expression(NodeIndex index) {
+    if (index == no_node) {
+        throw std::runtime_error("Null expression encountered during compilation");
+    }
+
+    const Node& expr = ast->node(index);
+    switch (expr.kind) {
+        case NodeKind::Binary:
+            compile_binary(expr);
+            break;
+        case NodeKind::Identifier:
+            compile_identifier(expr);
+            break;
+        case NodeKind::Literal:
+            compile_literal(expr);
+            break;
+        default:
+            throw std::runtime_error("Unknown expression type");
+    }
+}
+
+void Compiler::compile_binary(const Node& binary) {
+    if ((binary.flags & int_operands) && compile_int_binary(binary)) {
+        return;
+    }
+
+    compile_expression(binary.first);
+    compile_expression(binary.second);
+    stack_depth--;
+
+    switch (binary.op) {
+        case TokenType::Plus:              emit_op(OpCode::Add); break;
+        case TokenType::Minus:             emit_op(OpCode::Subtract); break;
+        case TokenType::Multiply:          emit_op(OpCode::Multiply); break;
+        case TokenType::Divide:            emit_op(OpCode::Divide); break;
+        case TokenType::GreaterThan:       emit_op(OpCode::Greater); break;
+        case TokenType::GreaterEqualsThan: emit_op(OpCode::GreaterEqual); break;
+        case TokenType::LessThan:          emit_op(OpCode::Less); break;
+        case TokenType::LessEqualsThan:    emit_op(OpCode::LessEqual); break;
+        case TokenType::EqualsEquals:      emit_op(OpCode::Equal); break;
+        case TokenType::NotEqual:          emit_op(OpCode::NotEqual); break;
+        case TokenType::And:               emit_op(OpCode::And); break;
+        case TokenType::Or:                emit_op(OpCode::Or); break;
+        default:
+            throw std::runtime_error("Unsupported binary operator: " +
+                                     Token::get_type_string(binary.op));
+    }
+}
+
+// And and Or fail on ints, so they keep the generic path and its error. A
+// literal right operand is folded into the instruction.
+bool Compiler::compile_int_binary(const Node& binary) {
+    OpCode op;
+    switch (binary.op) {
+        case TokenType::Plus:              op = OpCode::AddInt; break;
+        case TokenType::Minus:             op = OpCode::SubtractInt; break;
+        case TokenType::Multiply:          op = OpCode::MultiplyInt; break;
+        case TokenType::Divide:            op = OpCode::DivideInt; break;
+        case TokenType::GreaterThan:       op = OpCode::GreaterInt; break;
+        case TokenType::GreaterEqualsThan: op = OpCode::GreaterEqualInt; break;
+        case TokenType::LessThan:          op = OpCode::LessInt; break;
+        case TokenType::LessEqualsThan:    op = OpCode::LessEqualInt; break;
+        case TokenType::EqualsEquals:      op = OpCode::EqualInt; break;
+        case TokenType::NotEqual:          op = OpCode::NotEqualInt; break;
+        default:                           return false;
+    }
+
+    compile_expression(binary.first);
+    const Node& right = ast->node(binary.second);
+    if (right.kind == NodeKind::Literal) {
+        constexpr int distance = static_cast<int>(OpCode::AddIntConstant) - static_cast<int>(OpCode::AddInt);
+        emit_op(static_cast<OpCode>(static_cast<int>(op) + distance), right.first);
+    } else {
+        compile_expression(binary.second);
+        emit_op(op);
+        stack_depth--;
+    }
+    return true;
+}
+
+// A definite binding is always assigned when it is read, so it is fetched
+// straight from its slot. Others may have to fall through to a shadowed
+// scope and go through the variable table.
+void Compiler::compile_identifier(const Node& identifier) {
+    Binding binding = ast->binding(identifier);
+    if (binding.slot >= 0 && binding.definite) {
+        emit_op(OpCode::GetLocal, static_cast<uint32_t>(binding.slot));
+        emit_operand(static_cast<uint32_t>(binding.depth));
+        push_value();
+        return;
+    }
+    chunk.variables.push_back(VariableRef{binding, ast->interner.str(identifier.first)});
+    emit_op(binding.slot < 0 ? OpCode::UndefinedVariable : OpCode::GetVariable,
+            static_cast<uint32_t>(chunk.variables.size() - 1));
+    push_value();
+}
+
+void Compiler::compile_literal(const Node& literal) {
+    emit_op(OpCode::Constant, literal.first);
+    push_value();
+}
+
+void Compiler::emit_op(OpCode op) {
+    *reserve_code(1) = static_cast<uint8_t>(op);
+}
+
+void Compiler::emit_op(OpCode op, uint32_t operand) {
+    uint8_t* at = reserve_code(1 + sizeof(operand));
+    at[0] = static_cast<uint8_t>(op);
+    std::memcpy(at + 1, &operand, sizeof(operand));
+}
+
+void Compiler::emit_operand(uint32_t operand) {
+    std::memcpy(reserve_code(sizeof(operand)), &operand, sizeof(operand));
+}
+
+// The code buffer is sized ahead and trimmed at the end, so emitting only
+// moves code_size in the common case.
+uint8_t* Compiler::reserve_code(size_t size) {
+    if (code_size + size > chunk.code.size()) {
+        chunk.code.resize(std::max(2 * chunk.code.size(), code_size + size));
+    }
+    uint8_t* at = chunk.code.data() + code_size;
+    code_size += size;
+    return at;
+}
+
+void Compiler::push_value() {
+    stack_depth++;
+    chunk.max_stack = std::max(chunk.max_stack, stack_depth);
+}
+
+size_t Compiler::emit_jump(OpCode op) {
+    emit_op(op, 0);
+    return code_size - sizeof(uint32_t);
+}
+
+void Compiler::patch_jump(size_t operand_offset) {
+    uint32_t target = static_cast<uint32_t>(code_size);
+    std::memcpy(&chunk.code[operand_offset], &target, sizeof(target));
+}
@@ -0,0 +1,44 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "ast.h"
+#include "bytecode.h"
+
+class Compiler {
+public:
+    Chunk compile(const Ast& program);
+
+private:
+    void compile_declaration(NodeIndex declaration);
+    void compile_statement(const Node& declaration);
+    void compile_dynamic_declaration(const Node& declaration);
+    void compile_block(const Node& block, bool use_new_scope);
+    void compile_if(const Node& if_stmnt);
+    void compile_loop(const Node& loop);
+
+    void compile_expression(NodeIndex expr);
+    void compile_binary(const Node& binary);
+    bool compile_int_binary(const Node& binary);
+    void compile_identifier(const Node& identifier);
+    void compile_literal(const Node& literal);
+
+    void emit_op(OpCode op);
+    void emit_op(OpCode op, uint32_t operand);
+    void emit_operand(uint32_t operand);
+    // Returns where the next `size` bytes of code go.
+    uint8_t* reserve_code(size_t size);
+    // Counts a value the code just emitted leaves on the stack.
+    void push_value();
+    size_t emit_jump(OpCode op);
+    void patch_jump(size_t operand_offset);
+
+    const Ast* ast = nullptr;
+    Chunk chunk;
+    // Bytes of chunk.code emitted so far; the rest is room to grow into.
+    size_t code_size = 0;
+    // Values on the stack after the code emitted so far. Both arms of an if
+    // leave it where they found it, so one count covers every path.
+    uint32_t stack_depth = 0;
+};
+
+#endif
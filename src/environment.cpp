@@ -1,30 +1,77 @@
 #include "environment.h"
+#include <algorithm>
 
-Environment::Environment() : parent(nullptr) {};
+Environment::Environment(std::pmr::memory_resource* resource)
+    : variables(resource), frames(resource) {}
 
-Environment::Environment(Environment* env) : parent(env) {};
+void Environment::reset(std::span<const Binding> globals) {
+    frames.clear();
+    enter(globals);
+}
+
+void Environment::enter(std::span<const Binding> shadowed) {
+    size_t base = top();
+    make_room(base + shadowed.size());
+    dynamic_type* slots = variables.data() + base;
+    std::fill_n(slots, shadowed.size(), dynamic_type());
+    frames.push_back({slots, shadowed});
+}
+
+void Environment::leave() {
+    frames.pop_back();
+}
 
-Environment::dynamic_type Environment::get_variable_value(const std::string& name) const {
-    if (variables.contains(name)) {
-        return variables.at(name); 
-    } else if (parent != nullptr && parent->has_reference(name)){
-        return parent->get_variable_value(name);
+const Environment::dynamic_type* Environment::get_variable_value(const Binding& binding) const {
+    const Frame* frame = &frames.back() - binding.depth;
+    if (binding.definite) {
+        return &frame->variables[binding.slot];
     }
-    else{
-        throw std::runtime_error(
-        std::string{"Error: variable '"} + name + "' does not exist");
+
+    // Until a scope assigns its slot, reads fall through to the scope the
+    // resolver recorded as shadowed.
+    int slot = binding.slot;
+    while (frame->variables[slot].is_undefined()) {
+        const Binding& outer = frame->shadowed[slot];
+        if (outer.slot < 0) {
+            return nullptr;
+        }
+        frame -= outer.depth;
+        slot = outer.slot;
     }
+    return &frame->variables[slot];
 }
 
-void Environment::add_variable(std::string name, dynamic_type variable){
-    variables.insert_or_assign(std::move(name), std::move(variable));
+// Slots past the old layout may still hold values from scopes that have
+// been left, so they are cleared.
+void Environment::grow(std::span<const Binding> shadowed) {
+    size_t old_end = top();
+    size_t new_end = old_end + shadowed.size() - frames.back().shadowed.size();
+    make_room(new_end);
+    std::fill(variables.begin() + old_end, variables.begin() + new_end, dynamic_type());
+    frames.back().shadowed = shadowed;
 }
 
-void Environment::remove_variable(const std::string& name){
-    variables.erase(name);
+void Environment::add_variable(int slot, dynamic_type variable){
+    frames.back().variables[slot] = variable;
 }
 
-bool Environment::has_reference(const std::string& name) const{
-    return variables.contains(name);
+size_t Environment::top() const {
+    if (frames.empty()) {
+        return 0;
+    }
+    const Frame& innermost = frames.back();
+    return innermost.variables - variables.data() + innermost.shadowed.size();
 }
 
+// Growing the buffer moves every scope's slots, so the open frames are
+// pointed at their new places.
+void Environment::make_room(size_t slot_count) {
+    if (variables.size() >= slot_count) {
+        return;
+    }
+    const dynamic_type* old_data = variables.data();
+    variables.resize(std::max(slot_count, 2 * variables.size()));
+    for (Frame& frame : frames) {
+        frame.variables = variables.data() + (frame.variables - old_data);
+    }
+}
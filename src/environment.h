@@ -1,20 +1,49 @@
-#include <unordered_map>
-#include <string>
-#include <variant>
+#pragma once
+#include <memory_resource>
+#include <span>
+#include <vector>
+#include "ast.h"
+#include "value.h"
 
+// The scopes being run, innermost last. Their slots sit end to end in one
+// buffer that is kept between scopes, so entering and leaving a scope only
+// moves the top of the stack; memory is allocated the first time the stack
+// gets that deep and never again.
 class Environment{
     public:
-        using dynamic_type = std::variant<int, double, std::string, bool>;
+        using dynamic_type = Value;
 
-        Environment();
-        Environment(Environment* parent);
+        explicit Environment(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        // Drops every scope and opens the global one.
+        void reset(std::span<const Binding> globals);
+        // Opens a scope whose slots are all unassigned. `shadowed` is the
+        // resolver's layout for it and must outlive the scope.
+        void enter(std::span<const Binding> shadowed);
+        void leave();
+
+        // Returns nullptr when no scope on the lookup path has assigned the
+        // variable yet. Unassigned slots hold an undefined Value. The pointer
+        // is only good until the next scope is entered.
+        const dynamic_type* get_variable_value(const Binding& binding) const;
+        // The slot of a definite binding, which is always assigned when read.
+        const dynamic_type& local(int depth, int slot) const {
+            return frames.end()[-1 - depth].variables[slot];
+        }
+        void add_variable(int slot, dynamic_type value);
+        // Adopts a larger layout for the innermost scope; existing slots keep
+        // their values.
+        void grow(std::span<const Binding> shadowed);
 
-        dynamic_type get_variable_value(const std::string& variable_name) const;
-        void add_variable(std::string name, dynamic_type value);
-        void remove_variable(const std::string& name);
-        bool has_reference(const std::string& name) const;
-           
     private:
-        std::unordered_map<std::string, dynamic_type> variables;
-        Environment* parent;
-};
\ No newline at end of file
+        struct Frame {
+            dynamic_type* variables;
+            std::span<const Binding> shadowed;
+        };
+
+        size_t top() const;
+        void make_room(size_t slot_count);
+
+        std::pmr::vector<dynamic_type> variables;
+        std::pmr::vector<Frame> frames;
+};
@@ -8,12 +8,12 @@ Error::Error(std::string msg, std::string c, int ln) {
     culprit = c;
 }
 
-void Error::print() const{
-    std::cout << "Error on line " << line_number << ": ";
+void Error::print(std::ostream& out) const{
+    out << "Error on line " << line_number << ": ";
     if (!culprit.empty()) {
-        std::cout << culprit << ": ";
+        out << culprit << ": ";
     }
-    std::cout << message << std::endl;
+    out << message << std::endl;
 }
 
 void ErrorTracker::add_error(const std::string& message, const std::string& culprit, int line_number) {
@@ -21,9 +21,13 @@ void ErrorTracker::add_error(const std::string& message, const std::string& culp
     errors.push_back(error);
 }
 
-void ErrorTracker::print_all() {
+void ErrorTracker::append(const ErrorTracker& other) {
+    errors.insert(errors.end(), other.errors.begin(), other.errors.end());
+}
+
+void ErrorTracker::print_all(std::ostream& out) const {
     for (const auto& err : errors) {
-        err.print();
+        err.print(out);
     }
 }
 
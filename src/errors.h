@@ -10,7 +10,7 @@ public:
     Error(std::string m, std::string c, int ln);
     Error(std::string msg) : message(msg), culprit(""), line_number(-1) {}
 
-    void print() const;
+    void print(std::ostream& out = std::cout) const;
 
 private:
     std::string message;
@@ -24,7 +24,9 @@ private:
 
 public:
     void add_error(const std::string& message, const std::string& culprit, int line_number);
-    void print_all();
+    // Adds the errors of `other` after these.
+    void append(const ErrorTracker& other);
+    void print_all(std::ostream& out = std::cout) const;
     bool has_errors() const;
 };
 
@@ -1,245 +1,244 @@
 #include "evaluator.h"
-#include <variant>
+#include <iostream>
+#include <stdexcept>
 
-Evaluator::Evaluator(){
-    current_environment = std::make_unique<Environment>();
-}
+Evaluator::Evaluator(OutputSink& output, Allocation allocation)
+    : output(output),
+      memory(allocation),
+      environment(memory.resource()),
+      binary_sites(memory.resource()) {}
 
 Evaluator::~Evaluator() = default;  
 
-Evaluator::evaluation Evaluator::evaluate_literal(const Literal* literal) {
-    if (!literal) {
-        throw std::runtime_error("Null literal encountered");
-    }
-
-    std::string literal_value = literal->value;
-    TokenType literal_type = literal->type;
-
-    if (literal_type == TokenType::Number) {
-        if (literal_value.empty()) {
-            throw std::runtime_error("Literal value is empty");
-        }
-        return std::stoi(literal_value);
-    } else if (literal_type == TokenType::Boolean) {
-        if (literal_value == "true") {
-            return true;
-        } else if (literal_value == "false") {
-            return false;
-        } else {
-            throw std::runtime_error("Unsupported boolean type");
-        }
-    }
-
-    return literal_value;
+Evaluator::evaluation Evaluator::evaluate_literal(const Node& literal) {
+    return ast->constants[literal.first];
 }
 
-Evaluator::evaluation Evaluator::evaluate_identifier(const Identifier* identifier) {
-    return current_environment->get_variable_value(identifier->identifier_name); 
-}
-
-
-struct BinaryEvaluator {
-    TokenType op;
+Evaluator::evaluation Evaluator::evaluate_identifier(const Node& identifier) {
+    stats.lookups++;
+    Binding binding = ast->binding(identifier);
+    const evaluation* value = binding.slot < 0
+        ? nullptr
+        : environment.get_variable_value(binding);
 
-    Evaluator::evaluation operator()(int l, int r) const {
-        switch (op) {
-            case TokenType::Plus:             return l + r;
-            case TokenType::Minus:            return l - r;
-            case TokenType::Multiply:         return l * r;
-            case TokenType::Divide:
-                if (r == 0) throw std::runtime_error("Division by zero");
-                return l / r;
-
-            case TokenType::GreaterThan:      return l > r;
-            case TokenType::GreaterEqualsThan:return l >= r;
-            case TokenType::LessThan:         return l < r;
-            case TokenType::LessEqualsThan:   return l <= r;
-
-            case TokenType::EqualsEquals:     return l == r;
-            case TokenType::NotEqual:         return l != r;
-
-            default:
-                throw std::runtime_error("Unsupported integer op: " +
-                                         Token::get_type_string(op));
-        }
+    if (!value) {
+        throw std::runtime_error(
+            "Error: variable '" + ast->interner.str(identifier.first) + "' does not exist");
     }
+    return *value;
+}
 
-    Evaluator::evaluation operator()(bool l, bool r) const {
-        switch (op) {
-            case TokenType::And:              return l && r;
-            case TokenType::Or:               return l || r;
-            case TokenType::EqualsEquals:     return l == r;
-            case TokenType::NotEqual:         return l != r;
-            default:
-                throw std::runtime_error("Unsupported boolean op: " +
-                                         Token::get_type_string(op));
-        }
-    }
+Evaluator::evaluation Evaluator::evaluate_binary(NodeIndex index, const Node& binary) {
+    auto left  = evaluate_expression(binary.first);
+    auto right = evaluate_expression(binary.second);
+    TokenType op = binary.op;
 
-    Evaluator::evaluation operator()(const std::string& l,
-                                     const std::string& r) const {
-        switch (op) {
-            case TokenType::EqualsEquals:     return l == r;
-            case TokenType::NotEqual:         return l != r;
-            default:
-                throw std::runtime_error("Unsupported string op: " +
-                                         Token::get_type_string(op));
-        }
+    if (binary.flags & int_operands) {
+        return int_binary(op, left.as_int(), right.as_int());
     }
 
-    template<typename L, typename R>
-    Evaluator::evaluation operator()(L, R) const {
-        throw std::runtime_error(
-            "Type mismatch in binary expression: " +
-            Token::get_type_string(op));
+    // Nearly every site only ever sees ints, so that case is tested first.
+    BinarySite& site = binary_sites[index];
+    if (site == BinarySite::Ints && left.is_int() && right.is_int()) {
+        stats.cache_hits++;
+        return int_binary(op, left.as_int(), right.as_int());
     }
-};
-
-
-Evaluator::evaluation Evaluator::evaluate_binary(const BinaryExpression* binary) {
-    auto left  = evaluate_expression(binary->left.get());
-    auto right = evaluate_expression(binary->right.get());
-    TokenType op = binary->op;
+    return evaluate_binary_site(site, op, left, right);
+}
 
-    return std::visit(BinaryEvaluator{op}, left, right);
+Evaluator::evaluation Evaluator::evaluate_binary_site(BinarySite& site, TokenType op,
+                                                      const evaluation& left, const evaluation& right) {
+    switch (site) {
+        case BinarySite::Ints:
+            break;
+        case BinarySite::Bools:
+            if (left.is_bool() && right.is_bool()) {
+                stats.cache_hits++;
+                return bool_binary(op, left.as_bool(), right.as_bool());
+            }
+            break;
+        case BinarySite::Strings:
+            if (left.is_string() && right.is_string()) {
+                stats.cache_hits++;
+                return string_binary(op, left, right);
+            }
+            break;
+        case BinarySite::Unseen:
+            if (left.type() != right.type()) {
+                site = BinarySite::Generic;
+            } else if (left.is_int()) {
+                site = BinarySite::Ints;
+            } else if (left.is_bool()) {
+                site = BinarySite::Bools;
+            } else if (left.is_string()) {
+                site = BinarySite::Strings;
+            } else {
+                site = BinarySite::Generic;
+            }
+            stats.cache_misses++;
+            return binary_operation(op, left, right);
+        case BinarySite::Generic:
+            stats.cache_misses++;
+            return binary_operation(op, left, right);
+    }
+
+    site = BinarySite::Generic;
+    stats.polymorphic_sites++;
+    stats.cache_misses++;
+    return binary_operation(op, left, right);
 }
 
-Evaluator::evaluation Evaluator::evaluate_expression(const Expression* expr) {
-    if (!expr) {
+Evaluator::evaluation Evaluator::evaluate_expression(NodeIndex index) {
+    if (index == no_node) {
         throw std::runtime_error("Null expression encountered during evaluation");
     }
 
-    if (auto binary = dynamic_cast<const BinaryExpression*>(expr)) {
-        return evaluate_binary(binary);
-    } else if (auto identifier = dynamic_cast<const Identifier*>(expr)) {
-        return evaluate_identifier(identifier);
-    } else if (auto literal = dynamic_cast<const Literal*>(expr)) {
-        return evaluate_literal(literal);
-    }
-
-    throw std::runtime_error("Unknown expression type");
-}
-
-void Evaluator::evaluate(const std::vector<Statement*>& statements) {
-    for (Statement* stmt : statements) {
-        evaluate_statement(stmt);
+    stats.steps++;
+    const Node& expr = ast->node(index);
+    switch (expr.kind) {
+        case NodeKind::Binary:
+            return evaluate_binary(index, expr);
+        case NodeKind::Identifier:
+            return evaluate_identifier(expr);
+        case NodeKind::Literal:
+            return evaluate_literal(expr);
+        default:
+            throw std::runtime_error("Unknown expression type");
     }
 }
 
-void Evaluator::evaluate_declaration(const Declaration* declaration){
-    if (!declaration){
+void Evaluator::evaluate_declaration(NodeIndex index){
+    if (index == no_node){
         throw std::runtime_error("null declaration encountered during evaluation");
     }
-    
-    if (auto decl = dynamic_cast<const DynamicDeclaration*>(declaration)) {
-        visit_dynamic_declaration(decl);
-    }
-    else if (auto stmnt = dynamic_cast<const Statement*>(declaration)){
-        evaluate_statement(stmnt);
+
+    stats.steps++;
+    ProfiledStatement profiled(profiler, *ast, index);
+
+    const Node& declaration = ast->node(index);
+    if (declaration.kind == NodeKind::DynamicDeclaration) {
+        visit_dynamic_declaration(declaration);
     }
     else{
-        throw std::runtime_error("unknown declaration type");
+        evaluate_statement(index);
     }
 }
 
-void Evaluator::evaluate_statement(const Declaration* declaration) {
-    if (!declaration) {
+void Evaluator::evaluate_statement(NodeIndex index) {
+    if (index == no_node) {
         throw std::runtime_error("Null statement encountered during evaluation");
     }
 
-    if (auto print_stmt = dynamic_cast<const PrintStatement*>(declaration)) {
-        visit_print_statement(print_stmt);
-    } else if (auto expr_stmt = dynamic_cast<const ExpressionStatement*>(declaration)) {
-        visit_expression_statement(expr_stmt);
-    } else if (auto block = dynamic_cast<const Block*>(declaration)){
-        visit_block_statement(block, true);
-    } else if (auto if_stmnt = dynamic_cast<const IfStatement*>(declaration)) {
-        visit_if_statement(if_stmnt);
-    } else if (auto loop_stmnt = dynamic_cast<const LoopStatement*>(declaration)){
-        visit_loop_statement(loop_stmnt);
-    } else {
-        throw std::runtime_error("Unknown statement type");
+    const Node& declaration = ast->node(index);
+    switch (declaration.kind) {
+        case NodeKind::PrintStatement:
+            visit_print_statement(declaration);
+            break;
+        case NodeKind::ExpressionStatement:
+            visit_expression_statement(declaration);
+            break;
+        case NodeKind::Block:
+            visit_block_statement(declaration, true);
+            break;
+        case NodeKind::If:
+            visit_if_statement(declaration);
+            break;
+        case NodeKind::Loop:
+            visit_loop_statement(declaration);
+            break;
+        default:
+            throw std::runtime_error("Unknown statement type");
     }
 }
 
-void Evaluator::visit_expression_statement(const ExpressionStatement* statement) {
-    evaluate_expression(statement->expr.get());
+void Evaluator::visit_expression_statement(const Node& statement) {
+    evaluate_expression(statement.first);
 }
 
-void Evaluator::visit_print_statement(const PrintStatement* stmt) {
-    evaluation value = evaluate_expression(stmt->expression.get());
-
-    std::visit([](auto&& v) {
-        using T = std::decay_t<decltype(v)>;
-        if constexpr (std::is_same_v<T, bool>) {
-            std::cout << std::boolalpha << v;
-        } else {
-            std::cout << v;
-        }
-    }, value);
-
-    std::cout << "\n";
+void Evaluator::visit_print_statement(const Node& stmt) {
+    evaluation value = evaluate_expression(stmt.first);
+    output.print_value(value);
 }
 
 
-void Evaluator::visit_dynamic_declaration(const DynamicDeclaration* declaration) {
-    evaluation value = evaluate_expression(declaration->value.get());
-    current_environment->add_variable(declaration->variable_name, value);
+void Evaluator::visit_dynamic_declaration(const Node& declaration) {
+    evaluation value = evaluate_expression(declaration.second);
+    environment.add_variable(static_cast<int>(declaration.third), value);
 }
 
-void Evaluator::visit_block_statement(const Block* block, bool use_new_scope) {
+void Evaluator::visit_block_statement(const Node& block, bool use_new_scope) {
 
     if (use_new_scope){
-        auto parent = std::move(current_environment);
-        current_environment = std::make_unique<Environment>(parent.get());
+        environment.enter(ast->scope_slots(block.third));
 
-        for (const auto& declaration : block->declarations) {
-            evaluate_declaration(declaration.get());
+        for (NodeIndex declaration : ast->block_children(block)) {
+            evaluate_declaration(declaration);
         }
-        current_environment = std::move(parent);
+        environment.leave();
     }
     else{
-        for (const auto& declaration : block->declarations) {
-            evaluate_declaration(declaration.get());
+        for (NodeIndex declaration : ast->block_children(block)) {
+            evaluate_declaration(declaration);
         }
     }
  
 }
 
-void Evaluator::visit_if_statement(const IfStatement* if_stmnt){
-    evaluation condition = evaluate_expression(if_stmnt->condition.get());
-    bool condition_value;
-    if (std::holds_alternative<bool>(condition)) {
-        condition_value = std::get<bool>(condition);
+void Evaluator::visit_if_statement(const Node& if_stmnt){
+    evaluation condition = evaluate_expression(if_stmnt.first);
+    if (!(if_stmnt.flags & boolean_condition) && !condition.is_bool()) {
+        throw std::runtime_error("If condition must be boolean");
     }
+    bool condition_value = condition.as_bool();
 
     if (condition_value == true){
-        visit_block_statement(if_stmnt->if_block.get(), true);
+        visit_block_statement(ast->node(if_stmnt.second), true);
     }
-    else if (if_stmnt->has_else_block == true){
-        visit_block_statement(if_stmnt->else_block.get(), true);
+    else if (if_stmnt.third != no_node){
+        visit_block_statement(ast->node(if_stmnt.third), true);
     }
 }
 
 
-void Evaluator::visit_loop_statement(const LoopStatement* loop){
+void Evaluator::visit_loop_statement(const Node& loop){
+    const Node& loop_block = ast->node(loop.second);
     bool condition_value = true;
     while (condition_value == true){
-        evaluation condition = evaluate_expression(loop->condition.get());
+        evaluation condition = evaluate_expression(loop.first);
 
-        if (!std::holds_alternative<bool>(condition)) {
+        if (!(loop.flags & boolean_condition) && !condition.is_bool()) {
             throw std::runtime_error("Loop condition must be boolean");
         }
 
-        condition_value = std::get<bool>(condition);
-        visit_block_statement(loop->loop_block.get(), false);
+        condition_value = condition.as_bool();
+        visit_block_statement(loop_block, false);
     }
 }
 
 
-void Evaluator::execute_program(const Program* program){
-    auto& program_declarations = program->declarations;
-    for (auto& declaration : program_declarations){
-        evaluate_declaration(declaration.get());
+// Streamed programs reuse node indices for every top-level declaration, so
+// the sites start over with each one.
+void Evaluator::reset_binary_sites() {
+    binary_sites.assign(ast->nodes.size(), BinarySite::Unseen);
+}
+
+void Evaluator::begin_program(const Ast& program) {
+    ast = &program;
+    environment.reset(ast->scope_slots(0));
+}
+
+void Evaluator::execute_top_level(NodeIndex declaration) {
+    environment.grow(ast->scope_slots(0));
+    reset_binary_sites();
+    evaluate_declaration(declaration);
+}
+
+void Evaluator::execute_program(const Ast& program){
+    ast = &program;
+    reset_binary_sites();
+    const Node& root = ast->node(ast->root);
+    environment.reset(ast->scope_slots(root.third));
+    for (NodeIndex declaration : ast->block_children(root)){
+        evaluate_declaration(declaration);
     }
-}
\ No newline at end of file
+}
@@ -1,35 +1,70 @@
 #pragma once
-#include <variant>
-#include <memory>
+#include <vector>
 #include "ast.h"
 #include "environment.h"
+#include "line_profiler.h"
+#include "memory.h"
+#include "output.h"
+#include "profile.h"
+#include "value.h"
 
 class Evaluator {
 public:
-    using evaluation = std::variant<int, double, std::string, bool>;
+    using evaluation = Value;
 
-    Evaluator();
+    // Whatever the program prints goes to `output`. Scopes and site tables
+    // are allocated as `allocation` says.
+    explicit Evaluator(OutputSink& output, Allocation allocation = Allocation::Global);
     ~Evaluator();
     
-    void execute_program(const Program* program);
-    void evaluate(const std::vector<std::unique_ptr<Statement>>& statements); 
-    void evaluate(const std::vector<Statement*>& statements);               
+    void execute_program(const Ast& program);
 
-    void evaluate_declaration(const Declaration* declaration);
-    void evaluate_statement(const Declaration* declaration);
+    // Runs a program one top-level declaration at a time while it is still
+    // being parsed and resolved.
+    void begin_program(const Ast& program);
+    void execute_top_level(NodeIndex declaration);
 
-    void visit_expression_statement(const ExpressionStatement* statement);
-    void visit_print_statement(const PrintStatement* stmt);
-    void visit_dynamic_declaration(const DynamicDeclaration* declaration);
-    void visit_block_statement(const Block* block, bool use_new_scope);
-    void visit_if_statement(const IfStatement* if_stmnt);
-    void visit_loop_statement(const LoopStatement* loop_stmnt);
+    void evaluate_declaration(NodeIndex declaration);
+    void evaluate_statement(NodeIndex declaration);
 
-    evaluation evaluate_expression(const Expression* expr);
-    evaluation evaluate_binary(const BinaryExpression* binary);
-    evaluation evaluate_identifier(const Identifier* identifier);
-    evaluation evaluate_literal(const Literal* literal);
+    void visit_expression_statement(const Node& statement);
+    void visit_print_statement(const Node& stmt);
+    void visit_dynamic_declaration(const Node& declaration);
+    void visit_block_statement(const Node& block, bool use_new_scope);
+    void visit_if_statement(const Node& if_stmnt);
+    void visit_loop_statement(const Node& loop_stmnt);
+
+    evaluation evaluate_expression(NodeIndex expr);
+    evaluation evaluate_binary(NodeIndex index, const Node& binary);
+    evaluation evaluate_identifier(const Node& identifier);
+    evaluation evaluate_literal(const Node& literal);
+
+    const ExecutionStats& statistics() const { return stats; }
+    // Times every statement that runs from now on; nullptr stops profiling.
+    void set_profiler(LineProfiler* line_profiler) { profiler = line_profiler; }
 
 private:
-    std::unique_ptr<Environment> current_environment; 
+    // Operand types a Binary node has seen. A site specializes on the first
+    // pair it evaluates and goes generic for good once it sees another.
+    enum class BinarySite : uint8_t {
+        Unseen,
+        Ints,
+        Bools,
+        Strings,
+        Generic
+    };
+
+    void reset_binary_sites();
+    evaluation evaluate_binary_site(BinarySite& site, TokenType op,
+                                    const evaluation& left, const evaluation& right);
+
+    OutputSink& output;
+    const Ast* ast = nullptr;
+    // Declared before the containers that allocate from it.
+    RuntimeMemory memory;
+    Environment environment;
+    ExecutionStats stats;
+    LineProfiler* profiler = nullptr;
+    // One per node of the program, indexed like Ast::nodes.
+    std::pmr::vector<BinarySite> binary_sites;
 };
@@ -0,0 +1,13 @@
+#include "interner.h"
+
+Symbol Interner::intern(std::string_view text) {
+    auto found = symbols.find(text);
+    if (found != symbols.end()) {
+        return found->second;
+    }
+
+    Symbol symbol = static_cast<Symbol>(strings.size());
+    const std::string& stored = strings.emplace_back(text);
+    symbols.emplace(std::string_view(stored), symbol);
+    return symbol;
+}
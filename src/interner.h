@@ -0,0 +1,36 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using Symbol = uint32_t;
+
+// Stores each distinct identifier name and string literal of a program once.
+// Interning the same text twice returns the same symbol and the same string
+// address, so interned strings compare equal exactly when their addresses do.
+class Interner {
+public:
+    Interner() = default;
+    // The lookup table holds views of the stored strings, which a copy
+    // would share with the original. A move takes the strings along.
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+    Interner(Interner&&) = default;
+    Interner& operator=(Interner&&) = default;
+
+    Symbol intern(std::string_view text);
+
+    const std::string& str(Symbol symbol) const { return strings[symbol]; }
+    std::string_view view(Symbol symbol) const { return strings[symbol]; }
+    size_t size() const { return strings.size(); }
+
+private:
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, Symbol> symbols;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "line_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+static uint64_t now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static const char* kind_name(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::DynamicDeclaration:  return "set";
+        case NodeKind::PrintStatement:      return "console_out";
+        case NodeKind::ExpressionStatement: return "expression";
+        case NodeKind::Block:               return "block";
+        case NodeKind::If:                  return "if";
+        case NodeKind::Loop:                return "loop";
+        default:                            return "statement";
+    }
+}
+
+uint32_t LineProfiler::site_of(const Ast& ast, NodeIndex statement) {
+    NodeKind kind = ast.node(statement).kind;
+    SourcePosition at = ast.position(statement);
+    uint64_t key = (static_cast<uint64_t>(at.line) << 32) | (static_cast<uint64_t>(at.column) << 8) |
+                   static_cast<uint64_t>(kind);
+    auto [found, added] = site_ids.try_emplace(key, static_cast<uint32_t>(sites.size()));
+    if (added) {
+        sites.push_back(Site{kind, at});
+    }
+    return found->second;
+}
+
+uint32_t LineProfiler::path_of(uint32_t parent, uint32_t site) {
+    uint64_t key = (static_cast<uint64_t>(parent) << 32) | site;
+    auto [found, added] = path_ids.try_emplace(key, static_cast<uint32_t>(paths.size()));
+    if (added) {
+        paths.push_back(Path{parent, site});
+    }
+    return found->second;
+}
+
+void LineProfiler::enter(const Ast& ast, NodeIndex statement) {
+    uint32_t site = site_of(ast, statement);
+    uint32_t path = path_of(stack.empty() ? no_path : stack.back().path, site);
+    uint32_t line = sites[site].at.line;
+    if (line >= lines.size()) {
+        lines.resize(line + 1);
+    }
+    sites[site].hits++;
+    lines[line].hits++;
+    lines[line].active++;
+    stack.push_back(Frame{path, line, now()});
+}
+
+void LineProfiler::leave() {
+    uint64_t end = now();
+    Frame frame = stack.back();
+    stack.pop_back();
+
+    uint64_t elapsed = end - frame.start;
+    uint64_t self = elapsed - std::min(elapsed, frame.children);
+    Path& path = paths[frame.path];
+    path.self += self;
+    sites[path.site].inclusive += elapsed;
+
+    Line& line = lines[frame.line];
+    line.self += self;
+    if (--line.active == 0) {
+        line.inclusive += elapsed;
+    }
+    if (!stack.empty()) {
+        stack.back().children += elapsed;
+    }
+}
+
+void LineProfiler::report_hot_lines(std::ostream& out, std::string_view source, size_t count) const {
+    std::vector<uint32_t> order;
+    for (uint32_t line = 0; line < lines.size(); line++) {
+        if (lines[line].hits > 0) {
+            order.push_back(line);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (lines[a].inclusive != lines[b].inclusive) {
+            return lines[a].inclusive > lines[b].inclusive;
+        }
+        return a < b;
+    });
+    order.resize(std::min(order.size(), count));
+
+    std::vector<std::string_view> text;
+    for (size_t start = 0; start <= source.size();) {
+        size_t end = source.find('\n', start);
+        if (end == std::string_view::npos) {
+            end = source.size();
+        }
+        text.push_back(source.substr(start, end - start));
+        start = end + 1;
+    }
+
+    char row[96];
+    std::snprintf(row, sizeof(row), "%6s %12s %12s %12s  %s\n", "line", "hits", "incl ms", "self ms", "source");
+    out << row;
+    for (uint32_t line : order) {
+        const Line& stats = lines[line];
+        std::snprintf(row, sizeof(row), "%6u %12llu %12.3f %12.3f  ", line,
+                      static_cast<unsigned long long>(stats.hits), stats.inclusive / 1e6, stats.self / 1e6);
+        std::string_view code = line >= 1 && line <= text.size() ? text[line - 1] : std::string_view();
+        size_t indent = code.find_first_not_of(' ');
+        out << row << (indent == std::string_view::npos ? std::string_view() : code.substr(indent)) << "\n";
+    }
+
+    std::vector<uint32_t> statements(sites.size());
+    for (uint32_t site = 0; site < sites.size(); site++) {
+        statements[site] = site;
+    }
+    std::sort(statements.begin(), statements.end(), [&](uint32_t a, uint32_t b) {
+        return sites[a].inclusive > sites[b].inclusive;
+    });
+    statements.resize(std::min(statements.size(), count));
+
+    out << "\n";
+    std::snprintf(row, sizeof(row), "%-24s %12s %12s\n", "statement", "hits", "incl ms");
+    out << row;
+    for (uint32_t id : statements) {
+        const Site& site = sites[id];
+        std::string name = std::string(kind_name(site.kind)) + " " + std::to_string(site.at.line) + ":" +
+                           std::to_string(site.at.column);
+        std::snprintf(row, sizeof(row), "%-24s %12llu %12.3f\n", name.c_str(),
+                      static_cast<unsigned long long>(site.hits), site.inclusive / 1e6);
+        out << row;
+    }
+}
+
+void LineProfiler::write_collapsed(std::ostream& out) const {
+    std::vector<std::string> names(paths.size());
+    for (uint32_t id = 0; id < paths.size(); id++) {
+        const Path& path = paths[id];
+        const Site& site = sites[path.site];
+        std::string frame = std::string(kind_name(site.kind)) + "@" + std::to_string(site.at.line) + ":" +
+                            std::to_string(site.at.column);
+        // A path is always created after its parent, so the parent is named.
+        names[id] = path.parent == no_path ? frame : names[path.parent] + ";" + frame;
+        // Rounded up, so a stack that ran is never dropped for being brief.
+        out << names[id] << " " << (path.self + 999) / 1000 << "\n";
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef LINE_PROFILER_H
+#define LINE_PROFILER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+
+// Counts how often every statement of a script runs and how long it takes.
+// Time is inclusive of the statements nested inside, so a loop is charged
+// for its whole body. Statements are told apart by kind and source position
+// rather than node index, so a streamed program that reuses node indices
+// still adds up per statement.
+class LineProfiler {
+public:
+    void enter(const Ast& ast, NodeIndex statement);
+    void leave();
+
+    // Prints the `count` lines with the most inclusive time, with their text,
+    // then the `count` costliest statements.
+    void report_hot_lines(std::ostream& out, std::string_view source, size_t count) const;
+    // Writes one line per distinct stack of statements, in the collapsed
+    // format flame graph tools read: frames joined by ';', then the time
+    // spent in the innermost frame itself, in whole microseconds rounded up.
+    void write_collapsed(std::ostream& out) const;
+
+private:
+    struct Site {
+        NodeKind kind;
+        SourcePosition at;
+        uint64_t hits = 0;
+        uint64_t inclusive = 0;
+    };
+
+    struct Path {
+        uint32_t parent;
+        uint32_t site;
+        uint64_t self = 0;
+    };
+
+    struct Frame {
+        uint32_t path;
+        uint32_t line;
+        uint64_t start;
+        uint64_t children = 0;
+    };
+
+    // A line is charged inclusive time only by its outermost running
+    // statement, so nested statements on one line are not counted twice.
+    struct Line {
+        uint64_t hits = 0;
+        uint64_t inclusive = 0;
+        uint64_t self = 0;
+        uint32_t active = 0;
+    };
+
+    static constexpr uint32_t no_path = UINT32_MAX;
+
+    uint32_t site_of(const Ast& ast, NodeIndex statement);
+    uint32_t path_of(uint32_t parent, uint32_t site);
+
+    std::vector<Site> sites;
+    std::unordered_map<uint64_t, uint32_t> site_ids;
+    std::vector<Path> paths;
+    std::unordered_map<uint64_t, uint32_t> path_ids;
+    std::vector<Frame> stack;
+    std::vector<Line> lines;
+};
+
+// Keeps a statement entered while it runs and leaves it however it ends,
+// so one that throws is still charged and popped. Does nothing without a
+// profiler.
+class ProfiledStatement {
+public:
+    ProfiledStatement(LineProfiler* profiler, const Ast& ast, NodeIndex statement)
+        : profiler(profiler) {
+        if (profiler) {
+            profiler->enter(ast, statement);
+        }
+    }
+    ~ProfiledStatement() {
+        if (profiler) {
+            profiler->leave();
+        }
+    }
+    ProfiledStatement(const ProfiledStatement&) = delete;
+    ProfiledStatement& operator=(const ProfiledStatement&) = delete;
+
+private:
+    LineProfiler* profiler;
+};
+
+#endif
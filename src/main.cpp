@@ -1,32 +1,234 @@
+#include "source.h"
 #include "scanner.h"
-#include "parser.h"
-#include "token.h"
-#include "evaluator.h"
+#include "runner.h"
+#include "batch.h"
+#include "output.h"
+#include "profile.h"
+#include "line_profiler.h"
+#include "transpiler.h"
+#include <cstdio>
+#include <fstream>
 #include <iostream>
-#include <variant>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
-bool debug_mode = true;
+static const char* usage =
+    "usage: Iowa [options] <script.ia>\n"
+    "       Iowa [options] [--jobs=N] --batch <script.ia>...\n"
+    "       Iowa [options] [--jobs=N] --manifest=<list>\n"
+    "options: --engine=tree|vm|closure  --stream  --tokens  --output=<file>  --profile\n"
+    "         -O0  -O1  --dump-ast  --alloc=global|monotonic|pool  --cache=<dir>\n"
+    "         --hot-lines[=N]  --collapsed=<file>  --scan-workers=N\n"
+    "         --emit-cpp  --compile  (with --output=<binary>)\n";
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "ERROR: pass in 1 argument\n";
+    RunOptions options;
+    bool batch = false;
+    bool emit_cpp = false;
+    bool compile = false;
+    const char* output_path = nullptr;
+    Profile profile;
+    LineProfiler line_profiler;
+    size_t hot_lines = 0;
+    const char* collapsed_path = nullptr;
+    unsigned jobs = std::thread::hardware_concurrency();
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--engine=tree") {
+            options.engine = Engine::Tree;
+        } else if (argument == "--engine=vm") {
+            options.engine = Engine::Vm;
+        } else if (argument == "--engine=closure") {
+            options.engine = Engine::Closure;
+        } else if (argument == "--alloc=global") {
+            options.allocation = Allocation::Global;
+        } else if (argument == "--alloc=monotonic") {
+            options.allocation = Allocation::Monotonic;
+        } else if (argument == "--alloc=pool") {
+            options.allocation = Allocation::Pool;
+        } else if (argument == "--stream") {
+            options.streaming = true;
+        } else if (argument == "--profile") {
+            options.profile = &profile;
+        } else if (argument == "--hot-lines" || argument.starts_with("--hot-lines=")) {
+            options.line_profiler = &line_profiler;
+            hot_lines = 20;
+            if (argument.size() > 12) {
+                try {
+                    hot_lines = std::stoul(argument.substr(12));
+                } catch (const std::exception&) {
+                    std::cerr << "ERROR: invalid line count " << argument << "\n";
+                    return 1;
+                }
+            }
+        } else if (argument.starts_with("--collapsed=")) {
+            options.line_profiler = &line_profiler;
+            collapsed_path = argv[i] + 12;
+        } else if (argument == "--emit-cpp") {
+            emit_cpp = true;
+        } else if (argument == "--compile") {
+            compile = true;
+        } else if (argument == "-O0" || argument == "-O1") {
+            options.optimization_level = argument[2] - '0';
+        } else if (argument == "--dump-ast") {
+            options.dump_ast = true;
+        } else if (argument.starts_with("--cache=")) {
+            options.cache_directory = argument.substr(8);
+        } else if (argument == "--tokens") {
+            options.dump_tokens = true;
+        } else if (argument.starts_with("--output=")) {
+            output_path = argv[i] + 9;
+        } else if (argument == "--batch") {
+            batch = true;
+        } else if (argument.starts_with("--jobs=")) {
+            try {
+                jobs = static_cast<unsigned>(std::stoul(argument.substr(7)));
+            } catch (const std::exception&) {
+                std::cerr << "ERROR: invalid job count " << argument << "\n";
+                return 1;
+            }
+        } else if (argument.starts_with("--scan-workers=")) {
+            try {
+                options.scan_workers = static_cast<unsigned>(std::stoul(argument.substr(15)));
+            } catch (const std::exception&) {
+                std::cerr << "ERROR: invalid worker count " << argument << "\n";
+                return 1;
+            }
+        } else if (argument.starts_with("--manifest=")) {
+            batch = true;
+            try {
+                std::vector<std::string> listed = read_manifest(argument.substr(11).c_str());
+                paths.insert(paths.end(), listed.begin(), listed.end());
+            } catch (const std::runtime_error& error) {
+                std::cerr << error.what() << "\n";
+                return 1;
+            }
+        } else if (argument.starts_with("--")) {
+            std::cerr << "ERROR: unknown option " << argument << "\n";
+            return 1;
+        } else {
+            paths.push_back(argument);
+        }
+    }
+
+    if (paths.empty() || (!batch && paths.size() > 1)) {
+        std::cerr << usage;
+        return 1;
+    }
+
+    if (options.streaming && options.engine != Engine::Tree) {
+        std::cerr << "ERROR: --stream runs on the tree engine only\n";
+        return 1;
+    }
+
+    if (options.streaming && options.dump_ast) {
+        std::cerr << "ERROR: --dump-ast needs the whole tree and cannot --stream\n";
         return 1;
     }
 
-    char* path = argv[1];
-    std::vector<Token> tokens = scan_source(path);
+    if (options.streaming && !options.cache_directory.empty()) {
+        std::cerr << "ERROR: --cache stores the whole tree and cannot --stream\n";
+        return 1;
+    }
+
+    if (options.line_profiler && options.engine != Engine::Tree) {
+        std::cerr << "ERROR: --hot-lines and --collapsed run on the tree engine only\n";
+        return 1;
+    }
+
+    if ((emit_cpp || compile) && batch) {
+        std::cerr << "ERROR: --emit-cpp and --compile translate a single script\n";
+        return 1;
+    }
 
-    if (debug_mode){
-        for (const Token& t : tokens) {
-            std::cout << Token::get_type_string(t.get_type()) << ": " << t.get_value() << "\n";
+    if ((emit_cpp || compile) && (options.dump_tokens || options.dump_ast)) {
+        std::cerr << "ERROR: --emit-cpp and --compile cannot be combined with --tokens or --dump-ast\n";
+        return 1;
+    }
+
+    // With --compile, --output names the executable instead.
+    OutputSink output = OutputSink::to_stdout();
+    if (output_path != nullptr && !compile) {
+        try {
+            output = OutputSink::to_file(output_path);
+        } catch (const std::runtime_error& error) {
+            std::cerr << error.what() << "\n";
+            return 1;
         }
     }
-    
-    Parser parser(tokens);
-    Evaluator evaluator;
 
-    std::unique_ptr<Declaration> root = parser.program();
-    evaluator.execute_program(dynamic_cast<Program*>(root.get()));
+    if (batch) {
+        if (options.profile || options.line_profiler) {
+            std::cerr << "ERROR: profiling runs on a single script\n";
+            return 1;
+        }
+        return run_batch(paths, options, jobs, output);
+    }
 
-    return 0;
-}
\ No newline at end of file
+    SourceBuffer source = SourceBuffer::from_string("");
+    try {
+        source = SourceBuffer::map_file(paths[0].c_str());
+    } catch (const std::runtime_error& error) {
+        fail(error.what());
+    }
+
+    if (emit_cpp || compile) {
+        try {
+            std::string translated = transpile_source(source.text(), options);
+            if (!compile) {
+                output.write(translated);
+                output.flush();
+                return 0;
+            }
+
+            std::string binary_path = paths[0].ends_with(".ia")
+                ? paths[0].substr(0, paths[0].size() - 3)
+                : paths[0] + ".bin";
+            if (output_path != nullptr) {
+                binary_path = output_path;
+            }
+            std::string cpp_path = binary_path + ".cpp";
+            if (!(std::ofstream(cpp_path) << translated)) {
+                throw std::runtime_error("ERROR: could not write " + cpp_path);
+            }
+            compile_cpp(cpp_path, binary_path);
+            std::remove(cpp_path.c_str());
+        } catch (const std::exception& error) {
+            std::cerr << error.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    int status = 0;
+    count_allocations(options.profile != nullptr);
+    try {
+        run_source(source.text(), options, output);
+        output.flush();
+    } catch (const std::exception& error) {
+        output.flush();
+        std::cerr << error.what() << "\n";
+        status = 1;
+    }
+    count_allocations(false);
+
+    if (options.profile) {
+        profile.report(std::cerr);
+    }
+    if (hot_lines > 0) {
+        line_profiler.report_hot_lines(std::cerr, source.text(), hot_lines);
+    }
+    if (collapsed_path != nullptr) {
+        std::ofstream collapsed(collapsed_path);
+        line_profiler.write_collapsed(collapsed);
+        if (!collapsed) {
+            std::cerr << "ERROR: collapsed stacks could not be written\n";
+            return 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,16 @@
+#include "memory.h"
+
+// An engine only runs on one thread, so the unsynchronized pool is enough.
+RuntimeMemory::RuntimeMemory(Allocation allocation) {
+    switch (allocation) {
+        case Allocation::Monotonic:
+            owned = std::make_unique<std::pmr::monotonic_buffer_resource>();
+            break;
+        case Allocation::Pool:
+            owned = std::make_unique<std::pmr::unsynchronized_pool_resource>();
+            break;
+        case Allocation::Global:
+            break;
+    }
+    current = owned ? owned.get() : std::pmr::new_delete_resource();
+}
@@ -0,0 +1,34 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <memory>
+#include <memory_resource>
+
+// Where an engine's runtime containers (scope slots, operand stacks, site
+// tables) get their memory from.
+enum class Allocation {
+    // operator new and delete, shared by every thread.
+    Global,
+    // An arena that only ever grows and is released in one go when the
+    // engine is destroyed.
+    Monotonic,
+    // Pools of fixed-size blocks that are reused as containers grow and
+    // shrink.
+    Pool
+};
+
+// The memory resource an engine owns for one run. Nothing is shared
+// between engines, so scripts running side by side in a batch never
+// contend for the same allocator.
+class RuntimeMemory {
+public:
+    explicit RuntimeMemory(Allocation allocation);
+
+    std::pmr::memory_resource* resource() const { return current; }
+
+private:
+    std::unique_ptr<std::pmr::memory_resource> owned;
+    std::pmr::memory_resource* current;
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "optimizer.h"
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+TokenType literal_type(const Value& value) {
+    if (value.is_bool()) {
+        return TokenType::Boolean;
+    } else if (value.is_string()) {
+        return TokenType::String;
+    }
+    return TokenType::Number;
+}
+
+}
+
+// Children are always added before their parents, so one pass in index order
+// sees every operand folded before the expression that uses it.
+void Optimizer::fold_constants(Ast& ast) {
+    for (Node& node : ast.nodes) {
+        if (node.kind != NodeKind::Binary) {
+            continue;
+        }
+
+        const Node& left = ast.node(node.first);
+        const Node& right = ast.node(node.second);
+        if (left.kind != NodeKind::Literal || right.kind != NodeKind::Literal) {
+            continue;
+        }
+
+        Value folded;
+        try {
+            folded = binary_operation(node.op, ast.constants[left.first], ast.constants[right.first]);
+        } catch (const std::runtime_error&) {
+            continue;
+        }
+
+        TokenType type = literal_type(folded);
+        node = Node{NodeKind::Literal, type, 0, ast.add_constant(folded), no_node, no_node};
+    }
+}
+
+void Optimizer::prune_branches(Ast& ast) {
+    for (Node& node : ast.nodes) {
+        if (node.kind == NodeKind::If) {
+            const Node& condition = ast.node(node.first);
+            if (condition.kind != NodeKind::Literal || !ast.constants[condition.first].is_bool()) {
+                continue;
+            }
+            if (ast.constants[condition.first].as_bool()) {
+                node = ast.node(node.second);
+            } else if (node.third != no_node) {
+                node = ast.node(node.third);
+            } else {
+                node = Node{NodeKind::Block, TokenType::Eof, 0, 0, 0, no_scope};
+            }
+        } else if (node.kind == NodeKind::Block || node.kind == NodeKind::Program) {
+            // Nested blocks come first in index order, so a block holding
+            // only empty blocks is already empty when its parent is reached.
+            uint32_t kept = 0;
+            for (uint32_t i = 0; i < node.second; i++) {
+                NodeIndex child = ast.children[node.first + i];
+                const Node& statement = ast.node(child);
+                if (statement.kind != NodeKind::Block || statement.second > 0) {
+                    ast.children[node.first + kept++] = child;
+                }
+            }
+            node.second = kept;
+        }
+    }
+}
+
+namespace {
+
+void collect_assigned(const Ast& ast, const Node& block, std::unordered_set<Symbol>& names) {
+    for (NodeIndex index : ast.block_children(block)) {
+        const Node& statement = ast.node(index);
+        switch (statement.kind) {
+            case NodeKind::DynamicDeclaration:
+                names.insert(statement.first);
+                break;
+            case NodeKind::Block:
+                collect_assigned(ast, statement, names);
+                break;
+            case NodeKind::If:
+                collect_assigned(ast, ast.node(statement.second), names);
+                if (statement.third != no_node) {
+                    collect_assigned(ast, ast.node(statement.third), names);
+                }
+                break;
+            case NodeKind::Loop:
+                collect_assigned(ast, ast.node(statement.second), names);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Integer operators that cannot fail. Division can fail on zero, and the
+// logical operators fail on ints.
+bool never_fails(TokenType op) {
+    switch (op) {
+        case TokenType::Plus:
+        case TokenType::Minus:
+        case TokenType::Multiply:
+        case TokenType::GreaterThan:
+        case TokenType::GreaterEqualsThan:
+        case TokenType::LessThan:
+        case TokenType::LessEqualsThan:
+        case TokenType::EqualsEquals:
+        case TokenType::NotEqual:
+            return true;
+        default:
+            return false;
+    }
+}
+
+}
+
+// Declarations are only moved in front of a loop in the block that holds
+// it, so hoisted names resolve in the same scope the loop runs in. Blocks
+// are visited parents first, so an outer loop takes what it can before the
+// loops nested in it take the rest.
+bool Optimizer::hoist_invariants(Ast& ast) {
+    bool changed = false;
+    for (NodeIndex index = static_cast<NodeIndex>(ast.nodes.size()); index-- > 0;) {
+        NodeKind kind = ast.node(index).kind;
+        if (kind != NodeKind::Block && kind != NodeKind::Program) {
+            continue;
+        }
+
+        std::span<const NodeIndex> children = ast.block_children(ast.node(index));
+        std::vector<NodeIndex> statements(children.begin(), children.end());
+        std::vector<NodeIndex> rebuilt;
+        for (NodeIndex statement : statements) {
+            if (ast.node(statement).kind == NodeKind::Loop) {
+                hoist_from_loop(ast, statement, rebuilt);
+            }
+            rebuilt.push_back(statement);
+        }
+
+        if (rebuilt.size() > statements.size()) {
+            uint32_t first = ast.add_children(rebuilt);
+            ast.node(index).first = first;
+            ast.node(index).second = static_cast<uint32_t>(rebuilt.size());
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void Optimizer::hoist_from_loop(Ast& ast, NodeIndex loop, std::vector<NodeIndex>& hoisted) {
+    assigned.clear();
+    collect_assigned(ast, ast.node(ast.node(loop).second), assigned);
+    hoist_from_scope(ast, loop, hoisted);
+}
+
+// The condition and the statements directly in the body run in the scope
+// the loop is in, and so do the loops among those statements. Expressions
+// in nested blocks could read names those blocks shadow, so they stay
+// where they are.
+void Optimizer::hoist_from_scope(Ast& ast, NodeIndex loop, std::vector<NodeIndex>& hoisted) {
+    hoist_from_expression(ast, ast.node(loop).first, hoisted);
+    std::span<const NodeIndex> children = ast.block_children(ast.node(ast.node(loop).second));
+    std::vector<NodeIndex> statements(children.begin(), children.end());
+    for (NodeIndex index : statements) {
+        const Node& statement = ast.node(index);
+        switch (statement.kind) {
+            case NodeKind::DynamicDeclaration:
+                hoist_from_expression(ast, statement.second, hoisted);
+                break;
+            case NodeKind::PrintStatement:
+            case NodeKind::ExpressionStatement:
+            case NodeKind::If:
+                hoist_from_expression(ast, statement.first, hoisted);
+                break;
+            case NodeKind::Loop:
+                hoist_from_scope(ast, index, hoisted);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Hoists the largest invariant binary expressions. The expression's node
+// becomes a read of the new variable, so whatever refers to it stays valid,
+// and the expression itself moves to a new node the declaration sets.
+void Optimizer::hoist_from_expression(Ast& ast, NodeIndex index, std::vector<NodeIndex>& hoisted) {
+    Node expr = ast.node(index);
+    if (expr.kind != NodeKind::Binary) {
+        return;
+    }
+    if (!is_invariant(ast, index)) {
+        hoist_from_expression(ast, expr.first, hoisted);
+        hoist_from_expression(ast, expr.second, hoisted);
+        return;
+    }
+
+    SourcePosition at = ast.position(index);
+    NodeIndex moved = ast.add_node(expr.kind, expr.op, expr.first, expr.second, expr.third, at);
+    ast.node(moved).flags = expr.flags;
+
+    Symbol name = ast.interner.intern("$licm" + std::to_string(temporaries++));
+    ast.node(index) = Node{NodeKind::Identifier, TokenType::Identifier, 0, name, 0, no_node};
+    hoisted.push_back(ast.add_node(NodeKind::DynamicDeclaration, TokenType::Set, name, moved, no_node, at));
+}
+
+// A definite read of a variable the loop never sets, or an int operator that
+// cannot fail applied to invariants.
+bool Optimizer::is_invariant(const Ast& ast, NodeIndex index) const {
+    const Node& expr = ast.node(index);
+    switch (expr.kind) {
+        case NodeKind::Literal:
+            return true;
+        case NodeKind::Identifier:
+            return (expr.flags & definite_binding) && !assigned.contains(expr.first);
+        case NodeKind::Binary:
+            return (expr.flags & int_operands) && never_fails(expr.op) &&
+                   is_invariant(ast, expr.first) && is_invariant(ast, expr.second);
+        default:
+            return false;
+    }
+}
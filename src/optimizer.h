@@ -0,0 +1,42 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.h"
+
+// Rewrites a parsed program in place before it is resolved and executed.
+class Optimizer {
+public:
+    // Replaces every binary expression whose operands are both constants with
+    // the constant it evaluates to. Expressions that would fail at runtime,
+    // such as a division by zero, are left for the runtime to report.
+    void fold_constants(Ast& ast);
+
+    // Replaces an `if` whose condition is a boolean constant with the block
+    // that runs, or with nothing, and drops blocks left without statements.
+    // Runs after fold_constants, before the program is resolved.
+    void prune_branches(Ast& ast);
+
+    // Moves expressions that give the same value on every iteration of a
+    // loop, such as `n * 4` in `loop (i < n * 4)`, into `$licm` variables set
+    // just before the loop. Only expressions that cannot fail are moved, so
+    // output and errors stay in the same order. Relies on the bindings and
+    // on the TypeChecker's flags; returns true when it changed the program,
+    // which then has to be resolved again.
+    bool hoist_invariants(Ast& ast);
+
+private:
+    void hoist_from_loop(Ast& ast, NodeIndex loop, std::vector<NodeIndex>& hoisted);
+    void hoist_from_scope(Ast& ast, NodeIndex loop, std::vector<NodeIndex>& hoisted);
+    void hoist_from_expression(Ast& ast, NodeIndex expr, std::vector<NodeIndex>& hoisted);
+    bool is_invariant(const Ast& ast, NodeIndex expr) const;
+
+    // Names set anywhere inside the loop being optimized.
+    std::unordered_set<Symbol> assigned;
+    uint32_t temporaries = 0;
+};
+
+#endif
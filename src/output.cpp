@@ -0,0 +1,121 @@
+#include "output.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <stdexcept>
+
+OutputSink::OutputSink(int descriptor, bool owned) : descriptor(descriptor), owned(owned) {
+    if (descriptor >= 0) {
+        buffer.reserve(flush_threshold + 256);
+    }
+}
+
+OutputSink OutputSink::to_stdout() {
+    return OutputSink(STDOUT_FILENO, false);
+}
+
+OutputSink OutputSink::to_file(const char* path) {
+    int descriptor = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0) {
+        throw std::runtime_error("ERROR: output file could not be opened");
+    }
+    return OutputSink(descriptor, true);
+}
+
+OutputSink OutputSink::to_memory() {
+    return OutputSink(-1, false);
+}
+
+OutputSink::OutputSink(OutputSink&& other) noexcept
+    : buffer(std::move(other.buffer)), descriptor(other.descriptor), owned(other.owned) {
+    other.descriptor = -1;
+    other.owned = false;
+}
+
+OutputSink& OutputSink::operator=(OutputSink&& other) noexcept {
+    if (this != &other) {
+        release();
+        buffer = std::move(other.buffer);
+        descriptor = other.descriptor;
+        owned = other.owned;
+        other.descriptor = -1;
+        other.owned = false;
+    }
+    return *this;
+}
+
+OutputSink::~OutputSink() {
+    release();
+}
+
+// Output that cannot be written any more is dropped rather than thrown from
+// a destructor.
+void OutputSink::release() {
+    try {
+        flush();
+    } catch (const std::runtime_error&) {
+    }
+    if (owned) {
+        close(descriptor);
+    }
+    descriptor = -1;
+    owned = false;
+}
+
+void OutputSink::write_int(int value) {
+    char digits[16];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+    write(std::string_view(digits, end - digits));
+}
+
+// Matches what std::ostream prints for a double by default.
+void OutputSink::write_double(double value) {
+    char digits[32];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value,
+                                      std::chars_format::general, 6);
+    write(std::string_view(digits, end - digits));
+}
+
+void OutputSink::print_value(const Value& value) {
+    switch (value.type()) {
+        case Value::Type::Int:
+            write_int(value.as_int());
+            break;
+        case Value::Type::Double:
+            write_double(value.as_double());
+            break;
+        case Value::Type::String:
+            write(value.as_string());
+            break;
+        case Value::Type::Bool:
+            write(value.as_bool() ? "true" : "false");
+            break;
+        case Value::Type::Undefined:
+            break;
+    }
+    put('\n');
+}
+
+void OutputSink::flush() {
+    if (descriptor < 0 || buffer.empty()) {
+        return;
+    }
+    write_through(buffer);
+    buffer.clear();
+}
+
+void OutputSink::write_through(std::string_view text) {
+    while (!text.empty()) {
+        ssize_t written = ::write(descriptor, text.data(), text.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("ERROR: output could not be written");
+        }
+        text.remove_prefix(static_cast<size_t>(written));
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "value.h"
+
+// Collects everything a script prints and hands it on in large writes.
+// Output goes to a file descriptor (stdout or a file the sink opened) once
+// the buffer passes flush_threshold, on flush() and when the sink is
+// destroyed. A memory sink keeps everything for captured() instead.
+class OutputSink {
+public:
+    static constexpr size_t flush_threshold = 64 * 1024;
+
+    static OutputSink to_stdout();
+    // Creates or truncates the file. Throws std::runtime_error on failure.
+    static OutputSink to_file(const char* path);
+    static OutputSink to_memory();
+
+    OutputSink(OutputSink&& other) noexcept;
+    OutputSink& operator=(OutputSink&& other) noexcept;
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+    ~OutputSink();
+
+    void write(std::string_view text) {
+        if (text.size() >= flush_threshold && descriptor >= 0) {
+            flush();
+            write_through(text);
+            return;
+        }
+        buffer.append(text);
+        flush_if_full();
+    }
+
+    void put(char character) {
+        buffer.push_back(character);
+        flush_if_full();
+    }
+
+    void write_int(int value);
+    void write_double(double value);
+
+    // Writes a value the way console_out shows it, followed by a newline.
+    void print_value(const Value& value);
+
+    // Throws std::runtime_error when the output cannot be written.
+    void flush();
+
+    // Everything written to a memory sink so far.
+    const std::string& captured() const { return buffer; }
+    std::string take() { return std::move(buffer); }
+
+private:
+    OutputSink(int descriptor, bool owned);
+
+    void flush_if_full() {
+        if (buffer.size() >= flush_threshold && descriptor >= 0) {
+            flush();
+        }
+    }
+    void write_through(std::string_view text);
+    void release();
+
+    std::string buffer;
+    int descriptor;
+    bool owned;
+};
+
+#endif
@@ -1,53 +1,84 @@
 #include "parser.h"
 #include "token.h"
 #include <vector>
-#include <memory>
+#include <algorithm>
+#include <charconv>
+#include <span>
+#include <stdexcept>
 #include "errors.h"
 
-Token Parser::peek() const {
-    return tokens.at(current);
+TokenType Parser::kind_at(uint32_t index) const {
+    return lexer ? window[index & window_mask].kind : tokens->kind(index);
 }
 
-Token Parser::previous() {
-    if (current > 0) {
-        return tokens.at(current - 1);
+std::string_view Parser::text_at(uint32_t index) const {
+    return lexer ? window[index & window_mask].text : tokens->text(index);
+}
+
+SourcePosition Parser::position_at(uint32_t index) const {
+    if (lexer) {
+        const Lexeme& token = window[index & window_mask];
+        return SourcePosition{token.line, token.column};
     }
-    return Token("", TokenType::Eof);
+    return SourcePosition{tokens->line(index), tokens->column(index)};
+}
+
+NodeIndex Parser::add_node(SourcePosition at, NodeKind kind, TokenType op, uint32_t first,
+                           uint32_t second, uint32_t third) {
+    return ast.add_node(kind, op, first, second, third, at);
+}
+
+TokenType Parser::peek() const {
+    return kind_at(current);
+}
+
+uint32_t Parser::previous() const {
+    return current > 0 ? current - 1 : 0;
 }
 
-Token Parser::consume(TokenType expected, const std::string& errorMessage) {
-    if (peek().get_type() == expected) {
-        Token temp = peek();
+uint32_t Parser::consume(TokenType expected, const char* errorMessage) {
+    if (peek() == expected) {
+        uint32_t consumed = current;
         next();
-        return temp;
+        return consumed;
     }
     throw std::runtime_error(errorMessage +
-        " Got “" + Token::get_type_string(peek().get_type()) + "”.");
+        std::string(" Got “") + Token::get_type_string(peek()) + "”.");
 }
 
-Token Parser::next() {
-    if (current < number_of_tokens - 1) {
-        current++;
-        return peek();
+// Eof is always the last token, so the parser stays on it once reached.
+void Parser::next() {
+    if (is_at_end()) {
+        return;
+    }
+    current++;
+    if (lexer) {
+        window[current & window_mask] = lexer->next();
     }
-    return Token("", TokenType::Eof);
 }
 
-bool Parser::is_at_end() {
-    return (peek().get_type() == TokenType::Eof);
+bool Parser::is_at_end() const {
+    return (peek() == TokenType::Eof);
 }
 
 bool Parser::check(TokenType type) const {
-    return (peek().get_type() == type);
+    return (peek() == type);
+}
+
+Parser::Parser(const TokenStream& t) : tokens(&t), current(0) {
+    // A program never has more nodes than tokens, so the arena grows once.
+    ast.nodes.reserve(t.size());
+    ast.positions.reserve(t.size());
 }
 
-Parser::Parser(std::vector<Token> t) : tokens(t), current(0) {
-    number_of_tokens = t.size();
+Parser::Parser(Lexer& l) : lexer(&l), current(0) {
+    window[0] = lexer->next();
 }
 
-bool Parser::match(std::vector<TokenType> types) {
-    for (auto type : types) {
-        if (peek().get_type() == type) {
+bool Parser::match(std::initializer_list<TokenType> types) {
+    TokenType type = peek();
+    for (TokenType candidate : types) {
+        if (type == candidate) {
             next();
             return true;
         }
@@ -55,15 +86,32 @@ bool Parser::match(std::vector<TokenType> types) {
     return false;
 }
 
-std::unique_ptr<Declaration> Parser::program() {
-    std::vector<std::unique_ptr<Declaration>> declarations;
+NodeIndex Parser::finish_list(NodeKind kind, size_t mark, SourcePosition at) {
+    std::span<const NodeIndex> list(pending_children.data() + mark, pending_children.size() - mark);
+    uint32_t first = ast.add_children(list);
+    pending_children.resize(mark);
+    return add_node(at, kind, TokenType::Eof, first, static_cast<uint32_t>(list.size()), no_scope);
+}
+
+Ast Parser::program() {
+    SourcePosition at = position_at(current);
+    size_t mark = pending_children.size();
     while (!is_at_end()) {
-        declarations.push_back(declaration());
+        NodeIndex child = declaration();
+        pending_children.push_back(child);
+    }
+    ast.root = finish_list(NodeKind::Program, mark, at);
+    return std::move(ast);
+}
+
+NodeIndex Parser::next_declaration() {
+    if (is_at_end()) {
+        return no_node;
     }
-    return std::make_unique<Program>(std::move(declarations));
+    return declaration();
 }
 
-std::unique_ptr<Declaration> Parser::declaration() {
+NodeIndex Parser::declaration() {
     if (match({TokenType::Set})) {
         return dynamic_declaration();
     } else {
@@ -71,16 +119,17 @@ std::unique_ptr<Declaration> Parser::declaration() {
     }
 }
 
-std::unique_ptr<Declaration> Parser::dynamic_declaration() {
-    Token nameToken = consume(TokenType::Identifier, "Expected variable name after 'set'.");
-    std::string variable_name = nameToken.get_value();
+NodeIndex Parser::dynamic_declaration() {
+    SourcePosition at = position_at(previous());
+    uint32_t nameToken = consume(TokenType::Identifier, "Expected variable name after 'set'.");
+    Symbol variable_name = ast.interner.intern(text_at(nameToken));
     consume(TokenType::Equals, "Expected '=' after variable name.");
-    auto variable_value = expression();
+    NodeIndex variable_value = expression();
     consume(TokenType::Semicolon, "Expected ';' after variable declaration.");
-    return std::make_unique<DynamicDeclaration>(std::move(variable_name), std::move(variable_value));
+    return add_node(at, NodeKind::DynamicDeclaration, TokenType::Set, variable_name, variable_value);
 }
 
-std::unique_ptr<Declaration> Parser::statement() {
+NodeIndex Parser::statement() {
     if (match({TokenType::ConsoleOut})) {
         return print_statement();
     } else if (match({TokenType::BracketOpen})) {
@@ -94,150 +143,166 @@ std::unique_ptr<Declaration> Parser::statement() {
     }
 }
 
-std::unique_ptr<Statement> Parser::block() {
-    std::vector<std::unique_ptr<Declaration>> statements;
-    while (!(peek().get_type() == TokenType::BracketClose) && !is_at_end()) {
-        statements.push_back(declaration());
+NodeIndex Parser::block() {
+    SourcePosition at = position_at(previous());
+    size_t mark = pending_children.size();
+    while (!(peek() == TokenType::BracketClose) && !is_at_end()) {
+        NodeIndex child = declaration();
+        pending_children.push_back(child);
     }
     consume(TokenType::BracketClose, "Expect '}' after block.");
-    return std::make_unique<Block>(std::move(statements));
+    return finish_list(NodeKind::Block, mark, at);
 }
 
-std::unique_ptr<Statement> Parser::expression_statement() {
-    auto value = expression();
+NodeIndex Parser::expression_statement() {
+    SourcePosition at = position_at(current);
+    NodeIndex value = expression();
     consume(TokenType::Semicolon, "Expect ';' after value.");
-    return std::make_unique<ExpressionStatement>(std::move(value));
+    return add_node(at, NodeKind::ExpressionStatement, TokenType::Eof, value);
 }
 
-std::unique_ptr<Statement> Parser::if_statement() {
+NodeIndex Parser::if_statement() {
+    SourcePosition at = position_at(previous());
     consume(TokenType::ParenthesisOpen, "Expected '(' after 'if'.");
-    auto condition = expression();
+    NodeIndex condition = expression();
     consume(TokenType::ParenthesisClose, "Expected ')' after condition.");
 
     consume(TokenType::BracketOpen, "Expected '{' to start 'if' block.");
-    auto thenBlock = std::unique_ptr<Block>(dynamic_cast<Block*>(block().release()));
-    if (!thenBlock) {
-        throw std::runtime_error("If branch must be a block.");
-    }
+    NodeIndex thenBlock = block();
 
-    std::unique_ptr<Block> elseBlock = nullptr;
+    NodeIndex elseBlock = no_node;
     if (match({TokenType::Else})) {
         consume(TokenType::BracketOpen, "Expected '{' to start 'else' block.");
-        elseBlock = std::unique_ptr<Block>(dynamic_cast<Block*>(block().release()));
-        if (!elseBlock) {
-            throw std::runtime_error("Else branch must be a block.");
-        }
+        elseBlock = block();
     }
 
-    return std::make_unique<IfStatement>(std::move(condition), std::move(thenBlock), std::move(elseBlock));
+    return add_node(at, NodeKind::If, TokenType::If, condition, thenBlock, elseBlock);
 }
 
-std::unique_ptr<Statement> Parser::loop_statement() {
+NodeIndex Parser::loop_statement() {
+    SourcePosition at = position_at(previous());
     consume(TokenType::ParenthesisOpen, "Expected '(' after 'loop'.");
-    auto condition = expression();
+    NodeIndex condition = expression();
     consume(TokenType::ParenthesisClose, "Expected ')' after condition.");
     consume(TokenType::BracketOpen, "Expected '{' to start 'loop' block.");
-    auto loop_block = std::unique_ptr<Block>(dynamic_cast<Block*>(block().release()));
+    NodeIndex loop_block = block();
 
-    return std::make_unique<LoopStatement>(std::move(condition), std::move(loop_block));
+    return add_node(at, NodeKind::Loop, TokenType::Loop, condition, loop_block);
 }
 
-std::unique_ptr<Statement> Parser::print_statement() {
-    auto value = expression();
+NodeIndex Parser::print_statement() {
+    SourcePosition at = position_at(previous());
+    NodeIndex value = expression();
     consume(TokenType::Semicolon, "Expect ';' after value.");
-    return std::make_unique<PrintStatement>(std::move(value));
+    return add_node(at, NodeKind::PrintStatement, TokenType::ConsoleOut, value);
 }
 
-std::unique_ptr<Expression> Parser::expression() {
+NodeIndex Parser::expression() {
     return logic_or();
 }
 
-std::unique_ptr<Expression> Parser::logic_or() {
-    auto expr = logic_and();
+NodeIndex Parser::logic_or() {
+    NodeIndex expr = logic_and();
     while (match({TokenType::Or})) {
-        TokenType op = previous().get_type();
-        auto right = logic_and();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), op, std::move(right));
+        TokenType op = kind_at(previous());
+        SourcePosition at = position_at(previous());
+        NodeIndex right = logic_and();
+        expr = add_node(at, NodeKind::Binary, op, expr, right);
     }
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::logic_and() {
-    auto expr = equality();
+NodeIndex Parser::logic_and() {
+    NodeIndex expr = equality();
     while (match({TokenType::And})) {
-        TokenType op = previous().get_type();
-        auto right = equality();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), op, std::move(right));
+        TokenType op = kind_at(previous());
+        SourcePosition at = position_at(previous());
+        NodeIndex right = equality();
+        expr = add_node(at, NodeKind::Binary, op, expr, right);
     }
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::equality() {
-    auto expr = comparison();
+NodeIndex Parser::equality() {
+    NodeIndex expr = comparison();
     while (match({TokenType::EqualsEquals, TokenType::NotEqual})) {
-        TokenType op = previous().get_type();
-        auto right = comparison();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), op, std::move(right));
+        TokenType op = kind_at(previous());
+        SourcePosition at = position_at(previous());
+        NodeIndex right = comparison();
+        expr = add_node(at, NodeKind::Binary, op, expr, right);
     }
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::comparison() {
-    auto expr = term();
+NodeIndex Parser::comparison() {
+    NodeIndex expr = term();
     while (match({TokenType::GreaterThan, TokenType::LessThan, TokenType::GreaterEqualsThan, TokenType:: LessEqualsThan})) {
-        TokenType op = previous().get_type();
-        auto right = term();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), op, std::move(right));
+        TokenType op = kind_at(previous());
+        SourcePosition at = position_at(previous());
+        NodeIndex right = term();
+        expr = add_node(at, NodeKind::Binary, op, expr, right);
     }
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::term() {
-    auto expr = factor();
+NodeIndex Parser::term() {
+    NodeIndex expr = factor();
     while (match({TokenType::Plus, TokenType::Minus})) {
-        TokenType op = previous().get_type();
-        auto right = factor();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), op, std::move(right));
+        TokenType op = kind_at(previous());
+        SourcePosition at = position_at(previous());
+        NodeIndex right = factor();
+        expr = add_node(at, NodeKind::Binary, op, expr, right);
     }
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::factor() {
-    auto expr = primary();
+NodeIndex Parser::factor() {
+    NodeIndex expr = primary();
     while (match({TokenType::Multiply, TokenType::Divide})) {
-        TokenType op = previous().get_type();
-        auto right = factor();
-        if (!right) {
-            throw std::runtime_error("Missing right-hand side of binary operator");
-        }
-        expr = std::make_unique<BinaryExpression>(std::move(expr), op, std::move(right));
+        TokenType op = kind_at(previous());
+        SourcePosition at = position_at(previous());
+        NodeIndex right = factor();
+        expr = add_node(at, NodeKind::Binary, op, expr, right);
     }
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::primary() {
+NodeIndex Parser::primary() {
+    SourcePosition at = position_at(current);
     if (match({TokenType::Number})) {
-        return std::make_unique<Literal>(previous().get_value(), TokenType::Number);
+        std::string_view literal_value = text_at(previous());
+        int number = 0;
+        auto [end, error] = std::from_chars(literal_value.data(), literal_value.data() + literal_value.size(), number);
+        if (error != std::errc() || end != literal_value.data() + literal_value.size()) {
+            throw std::runtime_error("Invalid number literal: " + std::string(literal_value));
+        }
+        return add_node(at, NodeKind::Literal, TokenType::Number, ast.add_constant(number));
     }
     if (match({TokenType::Boolean})) {
-        return std::make_unique<Literal>(previous().get_value(), TokenType::Boolean);
+        return add_node(at, NodeKind::Literal, TokenType::Boolean,
+                            ast.add_constant(text_at(previous()) == "true"));
     }
     if (match({TokenType::String})) {
-        return std::make_unique<Literal>(previous().get_value(), TokenType::String);
+        return add_node(at, NodeKind::Literal, TokenType::String, ast.add_string_constant(text_at(previous())));
     }
     if (match({TokenType::Identifier})) {
-        return std::make_unique<Identifier>(previous().get_value());
+        return add_node(at, NodeKind::Identifier, TokenType::Identifier,
+                            ast.interner.intern(text_at(previous())), 0, no_node);
     }
     if (match({TokenType::ParenthesisOpen})) {
-        auto expr = expression();
+        NodeIndex expr = expression();
         if (!match({TokenType::ParenthesisClose})) {
             throw std::runtime_error("Expected closing parenthesis.");
         }
         return expr;
     }
+    // A streaming parser only still holds the tokens in its window.
+    uint32_t first = tokens ? 0 : current - std::min(current, window_mask);
+    uint32_t last = tokens ? static_cast<uint32_t>(tokens->size()) - 1 : current;
     std::string unmatched_tokens;
-    for (auto& token : tokens) {
-        unmatched_tokens += token.get_value() + " ";
+    for (uint32_t i = first; i <= last; i++) {
+        unmatched_tokens += kind_at(i) == TokenType::Eof ? "EOF" : text_at(i);
+        unmatched_tokens += " ";
     }
     throw std::runtime_error("ERROR: Could not parse program, unmatched token: " + unmatched_tokens);
 }
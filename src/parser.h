@@ -2,58 +2,77 @@
 #define PARSER_H
 
 #include "ast.h"
+#include "scanner.h"
 #include "token.h"
+#include <array>
+#include <initializer_list>
+#include <string>
 #include <vector>
-#include <variant>
-#include <memory>
 
 class Parser {
 public:
-    using evaluation = std::variant<int, double, std::string, bool>;
+    // The parser reads the stream in place; it must outlive the parser.
+    Parser(const TokenStream& t);
+    // Pulls tokens from the lexer on demand and keeps only the last few.
+    Parser(Lexer& l);
 
-    Parser(std::vector<Token> t);
+    TokenType peek() const;
+    uint32_t previous() const;
+    void next();
+    uint32_t consume(TokenType expected, const char* errorMessage);
 
-    Token peek() const;
-    Token previous();
-    Token next();
-    Token consume(TokenType expected, const std::string& errorMessage);
-
-    bool is_at_end();
-    bool match(std::vector<std::string> types);
-    bool match(std::vector<TokenType> types);
+    bool is_at_end() const;
+    bool match(std::initializer_list<TokenType> types);
     bool check(TokenType type) const;
 
-    std::unique_ptr<Declaration> program();
-    std::unique_ptr<Declaration> declaration();
-    std::unique_ptr<Declaration> statement();
-    std::unique_ptr<Declaration> dynamic_declaration();
-
-    std::unique_ptr<Statement> print_statement();
-    std::unique_ptr<Statement> if_statement();
-    std::unique_ptr<Statement> loop_statement();
-    std::unique_ptr<Statement> expression_statement();
-    std::unique_ptr<Statement> block();
-
-    std::unique_ptr<Expression> expression();
-    std::unique_ptr<Expression> logic_or();
-    std::unique_ptr<Expression> logic_and();
-    std::unique_ptr<Expression> equality();
-    std::unique_ptr<Expression> comparison();
-    std::unique_ptr<Expression> term();
-    std::unique_ptr<Expression> factor();
-    std::unique_ptr<Expression> primary();
-    std::unique_ptr<Expression> assignment();
-    std::unique_ptr<Expression> literal();
-    std::unique_ptr<Expression> identifier();
-    std::unique_ptr<Expression> number();
-    std::unique_ptr<Expression> string_literal();
-    std::unique_ptr<Expression> equality_operator();
-    std::unique_ptr<Expression> comparison_operator();
+    Ast program();
+    // Parses a single top-level declaration into tree(), or returns no_node
+    // at the end of the script. Lets a caller run a script while parsing it.
+    NodeIndex next_declaration();
+    Ast& tree() { return ast; }
+    // Tokens consumed so far, counting the current one.
+    uint32_t tokens_read() const { return current + 1; }
+
+    NodeIndex declaration();
+    NodeIndex statement();
+    NodeIndex dynamic_declaration();
+
+    NodeIndex print_statement();
+    NodeIndex if_statement();
+    NodeIndex loop_statement();
+    NodeIndex expression_statement();
+    NodeIndex block();
+
+    NodeIndex expression();
+    NodeIndex logic_or();
+    NodeIndex logic_and();
+    NodeIndex equality();
+    NodeIndex comparison();
+    NodeIndex term();
+    NodeIndex factor();
+    NodeIndex primary();
 
 private:
-    std::vector<Token> tokens;
-    int current;
-    int number_of_tokens;
+    // Moves the child indices pushed since `mark` into the AST's child list.
+    NodeIndex finish_list(NodeKind kind, size_t mark, SourcePosition at);
+    NodeIndex add_node(SourcePosition at, NodeKind kind, TokenType op, uint32_t first,
+                       uint32_t second = no_node, uint32_t third = no_node);
+    // Capture positions early: a streaming parser forgets old tokens.
+    SourcePosition position_at(uint32_t index) const;
+
+    TokenType kind_at(uint32_t index) const;
+    std::string_view text_at(uint32_t index) const;
+
+    // Tokens pulled from a lexer, indexed by position modulo the window size.
+    // The parser never looks further back than the previous token.
+    static constexpr uint32_t window_mask = 3;
+
+    const TokenStream* tokens = nullptr;
+    Lexer* lexer = nullptr;
+    std::array<Lexeme, window_mask + 1> window;
+    uint32_t current;
+    Ast ast;
+    std::vector<NodeIndex> pending_children;
 };
 
 #endif 
@@ -0,0 +1,117 @@
+#include "profile.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace {
+
+bool counting = false;
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+void* allocate(std::size_t size) {
+    if (counting) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+}
+
+// Every other form of new and delete is defined in terms of these.
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+// Only switched while a single thread is running.
+void count_allocations(bool enabled) {
+    counting = enabled;
+}
+
+AllocationCounts allocation_counts() {
+    return AllocationCounts{allocations.load(std::memory_order_relaxed),
+                            allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+void Profile::add(const char* phase, double milliseconds, uint64_t allocations, uint64_t bytes) {
+    for (Phase& existing : phases) {
+        if (std::strcmp(existing.name, phase) == 0) {
+            existing.milliseconds += milliseconds;
+            existing.allocations += allocations;
+            existing.bytes += bytes;
+            return;
+        }
+    }
+    phases.push_back(Phase{phase, milliseconds, allocations, bytes});
+}
+
+void Profile::report(std::ostream& out) const {
+    char line[128];
+    Phase total{"total", 0, 0, 0};
+    double execute_milliseconds = 0;
+
+    std::snprintf(line, sizeof(line), "%-10s %12s %12s %14s\n", "phase", "ms", "allocations", "bytes");
+    out << line;
+    for (const Phase& phase : phases) {
+        std::snprintf(line, sizeof(line), "%-10s %12.3f %12llu %14llu\n", phase.name, phase.milliseconds,
+                      static_cast<unsigned long long>(phase.allocations),
+                      static_cast<unsigned long long>(phase.bytes));
+        out << line;
+        total.milliseconds += phase.milliseconds;
+        total.allocations += phase.allocations;
+        total.bytes += phase.bytes;
+        if (std::strcmp(phase.name, "execute") == 0) {
+            execute_milliseconds = phase.milliseconds;
+        }
+    }
+    std::snprintf(line, sizeof(line), "%-10s %12.3f %12llu %14llu\n", total.name, total.milliseconds,
+                  static_cast<unsigned long long>(total.allocations),
+                  static_cast<unsigned long long>(total.bytes));
+    out << line;
+
+    double per_second = execute_milliseconds > 0 ? execution.steps / (execute_milliseconds / 1000) : 0;
+    std::string steps = std::string(step_name);
+    auto counter = [&](const std::string& label, double value) {
+        std::snprintf(line, sizeof(line), "%-24s %.0f\n", label.c_str(), value);
+        out << line;
+    };
+    counter("tokens", tokens);
+    counter("ast nodes", nodes);
+    counter("evaluated " + steps, execution.steps);
+    counter(steps + " per second", per_second);
+    counter("variable lookups", execution.lookups);
+    if (execution.cache_hits + execution.cache_misses > 0) {
+        counter("binary cache hits", execution.cache_hits);
+        counter("binary cache misses", execution.cache_misses);
+        counter("polymorphic sites", execution.polymorphic_sites);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Heap allocations made through operator new while counting is on, summed
+// over every thread. Counting is off unless a profile turns it on, which
+// leaves a single predictable branch per allocation.
+struct AllocationCounts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+void count_allocations(bool enabled);
+AllocationCounts allocation_counts();
+
+// What an engine did while running a program. The tree walker counts the
+// nodes it evaluated, the VM the instructions it executed.
+struct ExecutionStats {
+    uint64_t steps = 0;
+    uint64_t lookups = 0;
+    // Binary operators in the tree walker: evaluations that hit the operand
+    // types their site is specialized on, evaluations on the generic path,
+    // and sites that saw a second combination of types and went generic.
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+    uint64_t polymorphic_sites = 0;
+};
+
+// Time and allocations per phase of a run, plus the sizes the phases worked
+// on. Phases that run more than once, such as in streaming mode, add up.
+class Profile {
+public:
+    template <typename Work>
+    void measure(const char* phase, Work&& work) {
+        AllocationCounts before = allocation_counts();
+        auto start = std::chrono::steady_clock::now();
+        work();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        AllocationCounts after = allocation_counts();
+        add(phase, elapsed.count(), after.allocations - before.allocations, after.bytes - before.bytes);
+    }
+
+    void report(std::ostream& out) const;
+
+    uint64_t tokens = 0;
+    uint64_t nodes = 0;
+    ExecutionStats execution;
+    // "nodes" for the tree walker, "instructions" for the VM.
+    const char* step_name = "nodes";
+
+private:
+    struct Phase {
+        const char* name;
+        double milliseconds;
+        uint64_t allocations;
+        uint64_t bytes;
+    };
+
+    void add(const char* phase, double milliseconds, uint64_t allocations, uint64_t bytes);
+
+    std::vector<Phase> phases;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "resolver.h"
+#include <stdexcept>
+
+void Resolver::resolve(Ast& program) {
+    ast = &program;
+    scopes.clear();
+    ast->scopes.clear();
+    ast->shadowed.clear();
+
+    Node& root = ast->node(ast->root);
+    open_scope(root);
+    resolve_declarations(root);
+    close_scope();
+}
+
+void Resolver::begin(Ast& program) {
+    ast = &program;
+    scopes.clear();
+    ast->scopes.clear();
+    ast->shadowed.clear();
+
+    ast->scopes.push_back(Scope{0, 0});
+    scopes.push_back(ScopeState{0, {}, {}});
+}
+
+// Ast::release_declarations drops inner scopes after every declaration, so
+// the global slots stay contiguous at the front of Ast::shadowed.
+void Resolver::resolve_top_level(NodeIndex declaration) {
+    ScopeState& global = scopes.front();
+    std::vector<Symbol> names;
+    declare_name(global, declaration, names);
+    for (size_t i = 0; i < names.size(); i++) {
+        ast->shadowed.push_back(Binding{});
+        global.initialized.push_back(false);
+    }
+    ast->scopes.front().slot_count += static_cast<uint32_t>(names.size());
+
+    resolve_declaration(declaration);
+}
+
+void Resolver::open_scope(Node& block) {
+    block.third = static_cast<uint32_t>(ast->scopes.size());
+    ast->scopes.push_back(Scope{static_cast<uint32_t>(ast->shadowed.size()), 0});
+    scopes.push_back(ScopeState{block.third, {}, {}});
+
+    ScopeState& state = scopes.back();
+    std::vector<Symbol> names;
+    declare_names(state, block, names);
+    state.initialized.assign(names.size(), false);
+
+    int outer = static_cast<int>(scopes.size()) - 2;
+    for (Symbol name : names) {
+        Binding shadowed = lookup(name, outer);
+        shadowed.definite = false;
+        ast->shadowed.push_back(shadowed);
+    }
+    ast->scopes.back().slot_count = static_cast<uint32_t>(names.size());
+}
+
+void Resolver::close_scope() {
+    scopes.pop_back();
+}
+
+// Loop bodies run in the scope that encloses the loop, so their declarations
+// belong to it. Any other block opens a scope of its own.
+void Resolver::declare_names(ScopeState& state, const Node& block, std::vector<Symbol>& names) {
+    for (NodeIndex index : ast->block_children(block)) {
+        declare_name(state, index, names);
+    }
+}
+
+void Resolver::declare_name(ScopeState& state, NodeIndex index, std::vector<Symbol>& names) {
+    const Node& declaration = ast->node(index);
+    if (declaration.kind == NodeKind::DynamicDeclaration) {
+        Symbol name = declaration.first;
+        if (!state.slots.contains(name)) {
+            state.slots.emplace(name, static_cast<int>(state.slots.size()));
+            names.push_back(name);
+        }
+    } else if (declaration.kind == NodeKind::Loop) {
+        declare_names(state, ast->node(declaration.second), names);
+    }
+}
+
+// Finds the innermost scope at or outside scopes[from] that declares the name.
+// The depth is counted from the innermost open scope.
+Binding Resolver::lookup(Symbol name, int from) const {
+    int innermost = static_cast<int>(scopes.size()) - 1;
+    for (int i = from; i >= 0; i--) {
+        auto found = scopes[i].slots.find(name);
+        if (found != scopes[i].slots.end()) {
+            return Binding{innermost - i, found->second, scopes[i].initialized[found->second]};
+        }
+    }
+    return Binding{};
+}
+
+void Resolver::resolve_declarations(const Node& block) {
+    for (NodeIndex declaration : ast->block_children(block)) {
+        resolve_declaration(declaration);
+    }
+}
+
+void Resolver::resolve_declaration(NodeIndex index) {
+    Node& declaration = ast->node(index);
+    switch (declaration.kind) {
+        case NodeKind::DynamicDeclaration: {
+            resolve_expression(declaration.second);
+            ScopeState& state = scopes.back();
+            int slot = state.slots.at(declaration.first);
+            declaration.third = static_cast<uint32_t>(slot);
+            state.initialized[slot] = true;
+            break;
+        }
+        case NodeKind::PrintStatement:
+        case NodeKind::ExpressionStatement:
+            resolve_expression(declaration.first);
+            break;
+        case NodeKind::Block:
+            resolve_block(index, true);
+            break;
+        case NodeKind::If:
+            resolve_expression(declaration.first);
+            resolve_block(declaration.second, true);
+            if (declaration.third != no_node) {
+                resolve_block(declaration.third, true);
+            }
+            break;
+        case NodeKind::Loop:
+            resolve_expression(declaration.first);
+            resolve_block(declaration.second, false);
+            break;
+        default:
+            throw std::runtime_error("unknown declaration type");
+    }
+}
+
+void Resolver::resolve_block(NodeIndex index, bool use_new_scope) {
+    Node& block = ast->node(index);
+    if (use_new_scope) {
+        open_scope(block);
+        resolve_declarations(block);
+        close_scope();
+    } else {
+        resolve_declarations(block);
+    }
+}
+
+void Resolver::resolve_expression(NodeIndex index) {
+    Node& expr = ast->node(index);
+    switch (expr.kind) {
+        case NodeKind::Binary:
+            resolve_expression(expr.first);
+            resolve_expression(expr.second);
+            break;
+        case NodeKind::Identifier:
+            ast->set_binding(expr, lookup(expr.first, static_cast<int>(scopes.size()) - 1));
+            break;
+        case NodeKind::Literal:
+            break;
+        default:
+            throw std::runtime_error("Unknown expression type");
+    }
+}
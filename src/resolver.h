@@ -0,0 +1,42 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+
+// Binds every variable read and `set` to a slot in a statically known scope
+// so the runtime never looks variables up by name.
+class Resolver {
+public:
+    void resolve(Ast& ast);
+
+    // Resolves a program one top-level declaration at a time, as a streaming
+    // parser produces them. The global scope gains slots as names arrive.
+    void begin(Ast& ast);
+    void resolve_top_level(NodeIndex declaration);
+
+private:
+    struct ScopeState {
+        uint32_t scope;
+        std::unordered_map<Symbol, int> slots;
+        std::vector<bool> initialized;
+    };
+
+    void open_scope(Node& block);
+    void close_scope();
+    void declare_names(ScopeState& state, const Node& block, std::vector<Symbol>& names);
+    void declare_name(ScopeState& state, NodeIndex declaration, std::vector<Symbol>& names);
+    Binding lookup(Symbol name, int from) const;
+
+    void resolve_declarations(const Node& block);
+    void resolve_declaration(NodeIndex declaration);
+    void resolve_block(NodeIndex block, bool use_new_scope);
+    void resolve_expression(NodeIndex expr);
+
+    Ast* ast = nullptr;
+    std::vector<ScopeState> scopes;
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "runner.h"
+#include "ast_cache.h"
+#include "scanner.h"
+#include "parser.h"
+#include "token.h"
+#include "optimizer.h"
+#include "resolver.h"
+#include "ast_printer.h"
+#include "type_checker.h"
+#include "evaluator.h"
+#include "compiler.h"
+#include "vm.h"
+#include "closure.h"
+#include "transpiler.h"
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Errors found before the program runs, by the scanner or the type
+// checker, are thrown together, one line each, as a syntax error would be.
+static void throw_errors(const ErrorTracker& errors) {
+    if (!errors.has_errors()) {
+        return;
+    }
+    std::ostringstream message;
+    errors.print_all(message);
+    std::string text = message.str();
+    text.pop_back();
+    throw std::runtime_error(text);
+}
+
+// Runs one phase of the pipeline, timing it only when a profile is taken.
+template <typename Work>
+static void phase(Profile* profile, const char* name, Work&& work) {
+    if (profile) {
+        profile->measure(name, work);
+    } else {
+        work();
+    }
+}
+
+// Parses, resolves and runs one top-level declaration at a time, so output
+// starts before the script has been read to the end and memory stays bounded
+// by the largest top-level declaration rather than the whole script. The
+// scanner runs inside the parser here, so it is timed as part of parsing.
+static void run_streaming(std::string_view source, const RunOptions& options, OutputSink& output) {
+    Profile* profile = options.profile;
+    Lexer lexer(source);
+    Parser parser(lexer);
+    Ast& program = parser.tree();
+
+    Optimizer optimizer;
+    Resolver resolver;
+    TypeChecker checker;
+    ErrorTracker errors;
+    Evaluator evaluator(output, options.allocation);
+    evaluator.set_profiler(options.line_profiler);
+    resolver.begin(program);
+    checker.begin(program, errors);
+    evaluator.begin_program(program);
+
+    for (;;) {
+        NodeIndex declaration = no_node;
+        try {
+            phase(profile, "parse", [&] { declaration = parser.next_declaration(); });
+        } catch (const std::runtime_error&) {
+            // A character the scanner skipped usually breaks the declaration
+            // it was in, and its own error says why.
+            throw_errors(lexer.errors());
+            throw;
+        }
+        throw_errors(lexer.errors());
+        if (declaration == no_node) {
+            break;
+        }
+        if (options.optimization_level > 0) {
+            phase(profile, "optimize", [&] {
+                optimizer.fold_constants(program);
+                optimizer.prune_branches(program);
+            });
+        }
+        phase(profile, "resolve", [&] { resolver.resolve_top_level(declaration); });
+        phase(profile, "check", [&] { checker.check_top_level(declaration); });
+        throw_errors(errors);
+        phase(profile, "execute", [&] { evaluator.execute_top_level(declaration); });
+        if (profile) {
+            profile->nodes += program.nodes.size();
+        }
+        program.release_declarations();
+    }
+
+    if (profile) {
+        profile->tokens = parser.tokens_read();
+        profile->execution = evaluator.statistics();
+    }
+}
+
+// Scans, parses, optimizes, resolves and checks a whole script.
+static Ast prepare_program(std::string_view source, const RunOptions& options, OutputSink& output) {
+    Profile* profile = options.profile;
+    TokenStream tokens(source);
+    phase(profile, "scan", [&] { tokens = scan_source(source, options.scan_workers); });
+    throw_errors(tokens.errors());
+
+    if (options.dump_tokens){
+        for (size_t i = 0; i < tokens.size(); i++) {
+            output.write(Token::get_type_string(tokens.kind(i)));
+            output.write(": ");
+            output.write(tokens.kind(i) == TokenType::Eof ? "EOF" : tokens.text(i));
+            output.put('\n');
+        }
+    }
+
+    Ast program;
+    phase(profile, "parse", [&] {
+        Parser parser(tokens);
+        program = parser.program();
+    });
+
+    if (options.dump_ast) {
+        output.write("# before optimization\n");
+        print_ast(program, output);
+    }
+
+    Optimizer optimizer;
+    if (options.optimization_level > 0) {
+        phase(profile, "optimize", [&] {
+            optimizer.fold_constants(program);
+            optimizer.prune_branches(program);
+        });
+    }
+
+    Resolver resolver;
+    phase(profile, "resolve", [&] { resolver.resolve(program); });
+
+    ErrorTracker errors;
+    phase(profile, "check", [&] {
+        TypeChecker checker;
+        checker.check(program, errors);
+    });
+    throw_errors(errors);
+
+    // Hoisting needs the bindings and type flags, and adds variables that
+    // then need slots of their own.
+    if (options.optimization_level > 0) {
+        phase(profile, "hoist", [&] {
+            if (optimizer.hoist_invariants(program)) {
+                resolver.resolve(program);
+            }
+        });
+    }
+
+    if (options.dump_ast) {
+        output.write("# after optimization\n");
+        print_ast(program, output);
+    }
+
+    if (profile) {
+        profile->tokens = tokens.size();
+    }
+    return program;
+}
+
+void run_source(std::string_view source, const RunOptions& options, OutputSink& output) {
+    Profile* profile = options.profile;
+    if (options.streaming) {
+        run_streaming(source, options, output);
+        return;
+    }
+
+    // Entries hold the finished tree, so runs that show the tokens or the
+    // tree as parsed always prepare the program themselves.
+    bool use_cache = !options.cache_directory.empty() && !options.dump_tokens && !options.dump_ast;
+    std::optional<Ast> cached;
+    if (use_cache) {
+        phase(profile, "load", [&] {
+            cached = load_cached_ast(options.cache_directory, source, options.optimization_level);
+        });
+    }
+
+    Ast program;
+    if (cached) {
+        program = std::move(*cached);
+    } else {
+        program = prepare_program(source, options, output);
+        if (use_cache) {
+            phase(profile, "store", [&] {
+                store_cached_ast(options.cache_directory, source, options.optimization_level, program);
+            });
+        }
+    }
+
+    if (profile) {
+        profile->nodes = program.nodes.size();
+    }
+
+    if (options.engine == Engine::Vm) {
+        Chunk chunk;
+        phase(profile, "compile", [&] {
+            Compiler compiler;
+            chunk = compiler.compile(program);
+        });
+        VM vm(output, options.allocation);
+        phase(profile, "execute", [&] { vm.run(chunk); });
+        if (profile) {
+            profile->step_name = "instructions";
+            profile->execution = vm.statistics();
+        }
+    } else if (options.engine == Engine::Closure) {
+        ClosureProgram compiled;
+        phase(profile, "compile", [&] {
+            ClosureCompiler compiler;
+            compiled = compiler.compile(program);
+        });
+        ClosureEngine engine(output, options.allocation);
+        phase(profile, "execute", [&] { engine.run(compiled); });
+        if (profile) {
+            profile->execution = engine.statistics();
+        }
+    } else {
+        Evaluator evaluator(output, options.allocation);
+        evaluator.set_profiler(options.line_profiler);
+        phase(profile, "execute", [&] { evaluator.execute_program(program); });
+        if (profile) {
+            profile->execution = evaluator.statistics();
+        }
+    }
+}
+
+std::string transpile_source(std::string_view source, const RunOptions& options) {
+    OutputSink unused = OutputSink::to_memory();
+    Ast program = prepare_program(source, options, unused);
+    Transpiler transpiler;
+    return transpiler.translate(program);
+}
@@ -0,0 +1,51 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include <string>
+#include <string_view>
+
+#include "memory.h"
+#include "output.h"
+#include "line_profiler.h"
+#include "profile.h"
+
+enum class Engine {
+    Tree,
+    Vm,
+    Closure
+};
+
+struct RunOptions {
+    Engine engine = Engine::Tree;
+    // Runs each top-level declaration as soon as it is parsed (tree engine).
+    bool streaming = false;
+    // Writes every token to the output before running the script.
+    bool dump_tokens = false;
+    // Writes the tree before and after the optimizer to the output.
+    bool dump_ast = false;
+    // 0 runs the program as parsed. 1 folds constants, prunes constant
+    // branches and empty blocks, and hoists loop invariants.
+    int optimization_level = 1;
+    // Directory of finished programs to load instead of preparing the script
+    // again, and to store newly prepared ones in. Empty turns the cache off.
+    std::string cache_directory;
+    // Where the engine's scopes, stacks and site tables get their memory.
+    Allocation allocation = Allocation::Global;
+    // Threads used to scan the source; 0 picks from the source size.
+    unsigned scan_workers = 0;
+    // Collects time, allocations and counts per phase when set.
+    Profile* profile = nullptr;
+    // Times every statement when set. Tree engine only.
+    LineProfiler* line_profiler = nullptr;
+};
+
+// Scans, parses and runs a script, writing everything it prints to `output`.
+// Syntax and runtime errors are thrown as std::runtime_error.
+void run_source(std::string_view source, const RunOptions& options, OutputSink& output);
+
+// Prepares a script as run_source does, at the same optimization level, and
+// translates it to a standalone C++ program. Syntax and type errors are
+// thrown as std::runtime_error. Tokens and trees are not dumped.
+std::string transpile_source(std::string_view source, const RunOptions& options);
+
+#endif
@@ -1,11 +1,15 @@
 #include <stdlib.h>
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <iostream>
-#include <fstream>
+#include <thread>
 #include <vector>
 
 #include "errors.h"
 #include "token.h"
 #include "scanner.h"
+#include "simd.h"
 
 void fail(std::string message){
     std::cerr << message;
@@ -18,217 +22,389 @@ bool isNumeric(char character){
 }
 
 
-Scanner::Scanner(){
-    tokens = std::vector<Token> {};
-};
+static bool isAlpha(char character){
+    return ('a' <= character && character <= 'z') || ('A' <= character && character <= 'Z');
+}
 
 
-void Scanner::add_token(std::string token_value, TokenType token_type){
-    Token token(token_value, token_type);
-    tokens.push_back(token);
-};
+// Records the newlines marked in a block that starts at the cursor.
+static void skip_lines(Cursor& cursor, uint32_t newlines){
+    if (newlines != 0){
+        cursor.line_number += std::popcount(newlines);
+        cursor.line_start = cursor.current + (31 - std::countl_zero(newlines)) + 1;
+    }
+}
 
 
-void Scanner::add_token(const Token& token){
-    tokens.push_back(token);
+static uint32_t word_mask(simd::Block block){
+    return simd::in_range(block, 'a', 'z') | simd::in_range(block, 'A', 'Z') |
+           simd::in_range(block, '0', '9') | simd::equal(block, '_');
 }
 
 
-std::vector<Token> Scanner::get_tokens(){
-    return tokens;
+// Skips spaces and newlines. Tokens are mostly separated by a single blank,
+// so the next byte is checked before loading a whole block.
+static void skip_blanks(Cursor& cursor){
+    if (cursor.current < cursor.end && *cursor.current != ' ' && *cursor.current != '\n'){
+        return;
+    }
+    while (simd::fits(cursor.current, cursor.end)){
+        simd::Block block = simd::load(cursor.current);
+        uint32_t newlines = simd::equal(block, '\n');
+        uint32_t other = ~(simd::equal(block, ' ') | newlines) & simd::full_mask;
+        if (other != 0){
+            uint32_t stop = std::countr_zero(other);
+            skip_lines(cursor, newlines & ((1u << stop) - 1));
+            cursor.current += stop;
+            return;
+        }
+        skip_lines(cursor, newlines);
+        cursor.current += simd::block_size;
+    }
+    while (cursor.current < cursor.end && (*cursor.current == ' ' || *cursor.current == '\n')){
+        if (*cursor.current == '\n'){
+            cursor.new_line(cursor.current);
+        }
+        cursor.current++;
+    }
 }
 
 
-Token scan_string(std::ifstream& source) {
-    std::string result;
-    char next = source.peek();
-    while (next != std::char_traits<char>::eof() && next != '"') {
-        result += source.get();
-        next = source.peek();
+// Strings may span lines and run to the end of the source when unterminated.
+// The closing quote is consumed but is not part of the token.
+Token scan_string(Cursor& cursor) {
+    const char* start = cursor.current;
+    while (simd::fits(cursor.current, cursor.end)) {
+        simd::Block block = simd::load(cursor.current);
+        uint32_t quotes = simd::equal(block, '"');
+        uint32_t newlines = simd::equal(block, '\n');
+        if (quotes != 0) {
+            uint32_t quote = std::countr_zero(quotes);
+            skip_lines(cursor, newlines & ((1u << quote) - 1));
+            cursor.current += quote;
+            break;
+        }
+        skip_lines(cursor, newlines);
+        cursor.current += simd::block_size;
+    }
+    while (cursor.current < cursor.end && *cursor.current != '"') {
+        if (*cursor.current == '\n') {
+            cursor.new_line(cursor.current);
+        }
+        cursor.current++;
+    }
+    Token token(std::string_view(start, cursor.current - start), TokenType::String);
+    if (cursor.current < cursor.end) {
+        cursor.current++;
     }
-    source.get();              
-    return Token(result, TokenType::String);
+    return token;
 }
 
 
-Token scan_digit(std::ifstream& source) {
-    std::string digit = "";
-    char curr;
-    char next = source.peek();
-
-    while(next != std::char_traits<char>::eof() && isNumeric(next)){
-        curr = source.get();
-        next = source.peek();
-        digit += curr;
+Token scan_digit(Cursor& cursor) {
+    const char* start = cursor.current;
+    while (simd::fits(cursor.current, cursor.end)) {
+        uint32_t other = ~simd::in_range(simd::load(cursor.current), '0', '9') & simd::full_mask;
+        if (other != 0) {
+            cursor.current += std::countr_zero(other);
+            return Token(std::string_view(start, cursor.current - start), TokenType::Number);
+        }
+        cursor.current += simd::block_size;
     }
-
-    return Token(digit, TokenType::Number);
+    while (cursor.current < cursor.end && isNumeric(*cursor.current)) {
+        cursor.current++;
+    }
+    return Token(std::string_view(start, cursor.current - start), TokenType::Number);
 };
 
 
-std::string scan_word(std::ifstream& source) {
-    std::string word = "";
-    char next = source.peek();
-    char curr; 
-
-    while(next != std::char_traits<char>::eof() && (isalnum(next) || next == '_')){
-        curr = source.get();
-        next = source.peek();
-        word += curr;
+std::string_view scan_word(Cursor& cursor) {
+    const char* start = cursor.current;
+    while (simd::fits(cursor.current, cursor.end)) {
+        uint32_t other = ~word_mask(simd::load(cursor.current)) & simd::full_mask;
+        if (other != 0) {
+            cursor.current += std::countr_zero(other);
+            return std::string_view(start, cursor.current - start);
+        }
+        cursor.current += simd::block_size;
+    }
+    while (cursor.current < cursor.end &&
+           (isAlpha(*cursor.current) || isNumeric(*cursor.current) || *cursor.current == '_')) {
+        cursor.current++;
     }
-    return word;
+    return std::string_view(start, cursor.current - start);
 };
 
 
-Token scan_two_character_token(std::ifstream& source, char first, char second, TokenType first_type, TokenType second_type){
-    if (source.peek() == second){
-        source.get();
-        std::string token_val {first, second};
-        return Token(token_val, second_type);
+static Token scan_two_character_token(Cursor& cursor, const char* start, char second,
+                                      TokenType first_type, TokenType second_type){
+    if (cursor.current < cursor.end && *cursor.current == second){
+        cursor.current++;
+        return Token(std::string_view(start, 2), second_type);
     }
-    std::string token_val {first};
-    return Token(token_val, first_type);
+    return Token(std::string_view(start, 1), first_type);
 }
 
 
-void go_back_one(std::ifstream& source) {
-    std::streampos position = source.tellg(); 
+namespace {
+
+struct Keyword {
+    std::string_view word;
+    TokenType type = TokenType::Identifier;
+};
+
+constexpr Keyword keywords[] = {
+    {"if", TokenType::If},
+    {"else", TokenType::Else},
+    {"loop", TokenType::Loop},
+    {"console_out", TokenType::ConsoleOut},
+    {"set", TokenType::Set},
+    {"true", TokenType::Boolean},
+    {"false", TokenType::Boolean},
+};
+
+// Gives every keyword its own bucket, which the static_assert below checks.
+constexpr size_t keyword_hash(std::string_view word) {
+    return (static_cast<unsigned char>(word.front()) +
+            2 * static_cast<unsigned char>(word.back()) + word.size()) & 15;
+}
 
-    if (position != std::streampos(-1) && position > 0) {  
-        source.seekg(position - std::streamoff(1));
+constexpr std::array<Keyword, 16> keyword_table = [] {
+    std::array<Keyword, 16> table{};
+    for (const Keyword& keyword : keywords) {
+        table[keyword_hash(keyword.word)] = keyword;
     }
+    return table;
+}();
+
+constexpr bool keyword_hash_is_perfect() {
+    for (const Keyword& keyword : keywords) {
+        if (keyword_table[keyword_hash(keyword.word)].word != keyword.word) {
+            return false;
+        }
+    }
+    return true;
 }
 
-std::vector<Token> scan_source(char* path){
+static_assert(keyword_hash_is_perfect(), "keywords collide in keyword_table");
 
-    bool errored = false;
-    int line_number = 0;
-    char character;
+}
 
-    std::vector<Error> errors;
 
-    std::ifstream source_code(path);
+// Words are never empty, so the hash can always read both ends.
+static TokenType keyword_type(std::string_view word){
+    const Keyword& candidate = keyword_table[keyword_hash(word)];
+    return candidate.word == word ? candidate.type : TokenType::Identifier;
+}
 
-    if (!source_code.is_open()){
-        fail("ERROR: input file could not be opened");
-    }
 
-    Scanner scanner;
+Lexer::Lexer(std::string_view source, uint32_t first_line)
+    : cursor{source.data(), source.data() + source.size(), source.data(), first_line} {}
+
+
+Lexeme Lexer::lexeme(TokenType type, std::string_view text) const {
+    return Lexeme{type, text, cursor.line_number, cursor.column(text.data())};
+}
+
+
+Lexeme Lexer::lexeme(const Token& token) const {
+    return lexeme(token.get_type(), token.get_value());
+}
+
 
-    while (source_code.get(character)){
+Lexeme Lexer::next(){
+    while (cursor.current < cursor.end){
+        const char* start = cursor.current;
+        char character = *cursor.current++;
 
         switch (character){
 
             case '(':
-            {
-                scanner.add_token("(", TokenType::ParenthesisOpen);
-                break;
-            }
+                return lexeme(TokenType::ParenthesisOpen, std::string_view(start, 1));
             case ')':
-            {
-                scanner.add_token(")", TokenType::ParenthesisClose);
-                break;
-            }
+                return lexeme(TokenType::ParenthesisClose, std::string_view(start, 1));
             case '{':
-            {
-                scanner.add_token("{", TokenType::BracketOpen);
-                break;
-            }
+                return lexeme(TokenType::BracketOpen, std::string_view(start, 1));
             case '}':
-                scanner.add_token("}", TokenType::BracketClose);
-                break;
-            case '+':{
-                scanner.add_token("+", TokenType::Plus);
-                break;
-            }
-            case '-':{
-                scanner.add_token("-", TokenType::Minus);
-                break;
-            }
-            case '*': {
-                scanner.add_token("*", TokenType::Multiply);
-                break;
-            }
-            case '/': {
-                scanner.add_token("/", TokenType::Divide);
-                break;
-            }
+                return lexeme(TokenType::BracketClose, std::string_view(start, 1));
+            case '+':
+                return lexeme(TokenType::Plus, std::string_view(start, 1));
+            case '-':
+                return lexeme(TokenType::Minus, std::string_view(start, 1));
+            case '*':
+                return lexeme(TokenType::Multiply, std::string_view(start, 1));
+            case '/':
+                return lexeme(TokenType::Divide, std::string_view(start, 1));
+            case ';':
+                return lexeme(TokenType::Semicolon, std::string_view(start, 1));
             case '|':
-                if (source_code.peek() == '|'){
-                    scanner.add_token("||", TokenType::Or);
-                    source_code.get();
-                    break;
+                if (cursor.current < cursor.end && *cursor.current == '|'){
+                    cursor.current++;
+                    return lexeme(TokenType::Or, std::string_view(start, 2));
                 }
+                scan_errors.add_error("Invalid Syntax", std::string(1, character), cursor.line_number);
+                break;
             case '&':
-                if (source_code.peek() == '&'){
-                    scanner.add_token("&&", TokenType::And);
-                    source_code.get();
-                    break;
+                if (cursor.current < cursor.end && *cursor.current == '&'){
+                    cursor.current++;
+                    return lexeme(TokenType::And, std::string_view(start, 2));
                 }
-            case '<':
-                scanner.add_token(scan_two_character_token(source_code, '<', '=', TokenType::LessThan, TokenType::LessEqualsThan));
+                scan_errors.add_error("Invalid Syntax", std::string(1, character), cursor.line_number);
                 break;
+            case '<':
+                return lexeme(scan_two_character_token(cursor, start, '=', TokenType::LessThan, TokenType::LessEqualsThan));
             case '>':
-                scanner.add_token(scan_two_character_token(source_code, '>', '=', TokenType::GreaterThan, TokenType::GreaterEqualsThan));
-                break;
-            case '=':{
-                scanner.add_token(scan_two_character_token(source_code, '=', '=', TokenType::Equals, TokenType::EqualsEquals));
-                break;
-            }
+                return lexeme(scan_two_character_token(cursor, start, '=', TokenType::GreaterThan, TokenType::GreaterEqualsThan));
+            case '=':
+                return lexeme(scan_two_character_token(cursor, start, '=', TokenType::Equals, TokenType::EqualsEquals));
             case '\n':
-                line_number++;
+                cursor.new_line(start);
+                skip_blanks(cursor);
                 break;
             case ' ':
+                skip_blanks(cursor);
                 break;
-            case '"':
-                scanner.add_token(scan_string(source_code));  
-                break;       
-            case ';':
-                scanner.add_token(";", TokenType::Semicolon);
-                break;
+            case '"': {
+                uint32_t line = cursor.line_number;
+                uint32_t column = cursor.column(start);
+                Token token = scan_string(cursor);
+                return Lexeme{TokenType::String, token.get_value(), line, column};
+            }
             default:
                 if (isNumeric(character)){
-                    go_back_one(source_code);
-                    scanner.add_token(scan_digit(source_code));
-                    break;
+                    cursor.current = start;
+                    return lexeme(scan_digit(cursor));
+                }
+
+                if (isAlpha(character)){
+                    cursor.current = start;
+                    std::string_view word = scan_word(cursor);
+                    return lexeme(keyword_type(word), word);
                 }
 
-                if (isalpha(character)){
-                    go_back_one(source_code);
-                    std::string word = scan_word(source_code);
-            
-                    if (word == "if"){
-                        scanner.add_token(word, TokenType::If);
-                    }
-                    else if (word == "else"){
-                        scanner.add_token(word, TokenType::Else);
-                    }
-                    else if (word == "loop"){
-                        scanner.add_token(word, TokenType::Loop);
-                    }
-                    else if (word == "console_out"){
-                        scanner.add_token(word, TokenType::ConsoleOut);
-                    }
-                    else if (word == "set"){
-                        scanner.add_token(word, TokenType::Set);
-                    }
-                    else if (word == "true"){
-                        scanner.add_token(word, TokenType::Boolean);
-                    }
-                    else if (word == "false"){
-                        scanner.add_token(word, TokenType::Boolean);
-                    }
-                    else{
-                        scanner.add_token(word, TokenType::Identifier);
-                    };       
-                    break; 
+                scan_errors.add_error("Invalid Syntax", std::string(1, character), cursor.line_number);
+        }
+    }
+    return lexeme(TokenType::Eof, std::string_view(cursor.end, 0));
+}
+
+
+// Smallest piece of source worth scanning on a thread of its own.
+constexpr size_t parallel_chunk_size = 1 << 20;
+
+
+struct Chunk {
+    const char* begin;
+    const char* end;
+    uint32_t first_line;
+};
+
+
+// Scans one piece of a source into a stream over the whole source. Only the
+// last piece keeps its Eof token.
+static void scan_chunk(const Chunk& chunk, bool last, TokenStream& tokens){
+    Lexer lexer(std::string_view(chunk.begin, chunk.end - chunk.begin), chunk.first_line);
+
+    // Scripts average well over four bytes per token, so the arrays rarely
+    // grow more than once or twice.
+    tokens.reserve((chunk.end - chunk.begin) / 4 + 1);
+
+    Lexeme token = lexer.next();
+    while (token.kind != TokenType::Eof){
+        tokens.add(token.kind, token.text, token.line, token.column);
+        token = lexer.next();
+    }
+    if (last){
+        tokens.add(token.kind, token.text, token.line, token.column);
+    }
+    tokens.errors().append(lexer.errors());
+}
+
+
+template <typename Work>
+static void run_parallel(size_t count, Work work){
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for (size_t i = 1; i < count; i++){
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+}
+
+
+// Cuts the source into `count` pieces of roughly equal size. Strings are the
+// only tokens that span lines and quotes cannot be escaped, so a newline is a
+// safe place to cut exactly when an even number of quotes precede it. The
+// quotes and newlines in each equal region are counted in parallel; each cut
+// then moves forward from the start of its region to the first safe newline.
+// A region without one is merged into the piece before it.
+static std::vector<Chunk> split_source(std::string_view source, size_t count){
+    const char* begin = source.data();
+    const char* end = begin + source.size();
+    size_t region_size = source.size() / count;
+    auto region_start = [&](size_t i) { return i == count ? end : begin + i * region_size; };
+
+    std::vector<uint32_t> quotes(count);
+    std::vector<uint32_t> newlines(count);
+    run_parallel(count, [&](size_t i){
+        quotes[i] = static_cast<uint32_t>(std::count(region_start(i), region_start(i + 1), '"'));
+        newlines[i] = static_cast<uint32_t>(std::count(region_start(i), region_start(i + 1), '\n'));
+    });
+
+    std::vector<Chunk> chunks{Chunk{begin, end, 1}};
+    uint32_t quotes_before = quotes[0];
+    uint32_t newlines_before = newlines[0];
+    for (size_t i = 1; i < count; i++){
+        uint32_t quote_count = quotes_before;
+        uint32_t line_count = newlines_before;
+        for (const char* at = region_start(i); at < region_start(i + 1); at++){
+            if (*at == '"'){
+                quote_count++;
+            } else if (*at == '\n'){
+                line_count++;
+                if (quote_count % 2 == 0){
+                    chunks.back().end = at + 1;
+                    chunks.push_back(Chunk{at + 1, end, line_count + 1});
+                    break;
                 }
-              
-                errored = true;
-                Error error("Invalid Syntax", "", line_number);
-                errors.push_back(error);
+            }
         }
+        quotes_before += quotes[i];
+        newlines_before += newlines[i];
     }
-    scanner.add_token("EOF", TokenType::Eof);
-    return scanner.get_tokens();
-}
\ No newline at end of file
+    return chunks;
+}
+
+
+TokenStream scan_source(std::string_view source, unsigned workers){
+    if (workers == 0){
+        size_t useful = source.size() / parallel_chunk_size;
+        workers = static_cast<unsigned>(std::min<size_t>(useful, std::thread::hardware_concurrency()));
+    }
+
+    if (workers <= 1 || source.size() < workers){
+        TokenStream tokens(source);
+        scan_chunk(Chunk{source.data(), source.data() + source.size(), 1}, true, tokens);
+        return tokens;
+    }
+
+    std::vector<Chunk> chunks = split_source(source, workers);
+    std::vector<TokenStream> pieces(chunks.size(), TokenStream(source));
+    run_parallel(chunks.size(), [&](size_t i){
+        scan_chunk(chunks[i], i == chunks.size() - 1, pieces[i]);
+    });
+
+    size_t total = 0;
+    for (const TokenStream& piece : pieces){
+        total += piece.size();
+    }
+    TokenStream merged = std::move(pieces[0]);
+    merged.reserve(total);
+    for (size_t i = 1; i < pieces.size(); i++){
+        merged.append(pieces[i]);
+    }
+    return merged;
+}
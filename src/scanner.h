@@ -2,40 +2,65 @@
 #define SCANNER_H
 
 #include <iostream>
-#include <fstream>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 #include "token.h"
 #include "errors.h"
 
 
 void fail(std::string message);
 
-void add_token(std::vector<Token>& tokens, std::string value, TokenType type);
-
 bool isNumeric(char character);
 
-Token scan_string(std::ifstream& source);
+// Position of the scanner inside the source text.
+struct Cursor {
+    const char* current;
+    const char* end;
+    const char* line_start;
+    uint32_t line_number;
+
+    uint32_t column(const char* at) const {
+        return static_cast<uint32_t>(at - line_start) + 1;
+    }
+
+    void new_line(const char* at) {
+        line_number++;
+        line_start = at + 1;
+    }
+};
+
+Token scan_string(Cursor& cursor);
 
-Token scan_digit(std::ifstream& source);
+Token scan_digit(Cursor& cursor);
 
-Token scan_identifier(std::ifstream& source);
+std::string_view scan_word(Cursor& cursor);
 
-void go_back_one(std::ifstream& source);
+// Scans a source one token at a time, so a consumer can work through a
+// script without holding all of its tokens. Once the source is exhausted
+// every call returns an Eof token.
+class Lexer {
+public:
+    // A source that starts partway through a script must start at the
+    // beginning of a line, numbered first_line.
+    explicit Lexer(std::string_view source, uint32_t first_line = 1);
 
-std::vector<Token> scan_source(char* path);
+    Lexeme next();
+    // Characters that start no token. next() skips them.
+    const ErrorTracker& errors() const { return scan_errors; }
 
-class Scanner{
-    public:
-        Scanner();
-        
-        void add_token(std::string token_value, TokenType token_type);
-        void add_token(const Token& token);
-        std::vector<Token> get_tokens();
+private:
+    Lexeme lexeme(TokenType type, std::string_view text) const;
+    Lexeme lexeme(const Token& token) const;
 
-    private:
-        std::vector<Token> tokens; 
+    Cursor cursor;
+    ErrorTracker scan_errors;
 };
 
+// Scans a whole source. Large sources are split at newlines outside string
+// literals and the pieces are scanned on separate threads; the result is the
+// same as a sequential scan. With workers == 0 the number of pieces follows
+// from the source size and the hardware, 1 scans sequentially.
+TokenStream scan_source(std::string_view source, unsigned workers = 0);
+
 #endif
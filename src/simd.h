@@ -0,0 +1,93 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Byte classification over fixed-size blocks of text. Each function returns a
+// mask with bit i set when byte i of the block matches. AVX2 handles 32 bytes
+// at a time and SSE2 16. Without either, or when IOWA_SCALAR_LEXER is
+// defined, blocks are empty and callers fall back to their scalar loops.
+
+#if defined(__AVX2__) && !defined(IOWA_SCALAR_LEXER)
+#include <immintrin.h>
+#define IOWA_SIMD_NAME "avx2"
+
+namespace simd {
+
+using Block = __m256i;
+constexpr size_t block_size = 32;
+
+inline Block load(const char* at) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at));
+}
+
+inline uint32_t equal(Block block, char character) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(block, _mm256_set1_epi8(character))));
+}
+
+// Shifts the range down to start at -128 so one signed compare covers it.
+inline uint32_t in_range(Block block, char low, char high) {
+    Block shifted = _mm256_add_epi8(block, _mm256_set1_epi8(static_cast<char>(-128 - low)));
+    Block limit = _mm256_set1_epi8(static_cast<char>(-128 + (high - low) + 1));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(limit, shifted)));
+}
+
+}
+
+#elif defined(__SSE2__) && !defined(IOWA_SCALAR_LEXER)
+#include <emmintrin.h>
+#define IOWA_SIMD_NAME "sse2"
+
+namespace simd {
+
+using Block = __m128i;
+constexpr size_t block_size = 16;
+
+inline Block load(const char* at) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+}
+
+inline uint32_t equal(Block block, char character) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(block, _mm_set1_epi8(character))));
+}
+
+inline uint32_t in_range(Block block, char low, char high) {
+    Block shifted = _mm_add_epi8(block, _mm_set1_epi8(static_cast<char>(-128 - low)));
+    Block limit = _mm_set1_epi8(static_cast<char>(-128 + (high - low) + 1));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(limit, shifted)));
+}
+
+}
+
+#else
+#define IOWA_SIMD_NAME "scalar"
+
+namespace simd {
+
+struct Block {};
+constexpr size_t block_size = 0;
+
+inline Block load(const char*) { return {}; }
+inline uint32_t equal(Block, char) { return 0; }
+inline uint32_t in_range(Block, char, char) { return 0; }
+
+}
+
+#endif
+
+namespace simd {
+
+// Mask covering every byte of a block.
+constexpr uint32_t full_mask = block_size >= 32 ? UINT32_MAX : (1u << block_size) - 1;
+
+// True when a whole block starting at `at` lies before `end`.
+inline bool fits(const char* at, const char* end) {
+    return block_size > 0 && static_cast<size_t>(end - at) >= block_size;
+}
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <utility>
+
+SourceBuffer SourceBuffer::map_file(const char* path) {
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("ERROR: input file could not be opened");
+    }
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0) {
+        close(descriptor);
+        throw std::runtime_error("ERROR: input file could not be opened");
+    }
+
+    SourceBuffer buffer;
+    buffer.size = static_cast<size_t>(status.st_size);
+    if (buffer.size > 0) {
+        void* mapping = mmap(nullptr, buffer.size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED) {
+            close(descriptor);
+            throw std::runtime_error("ERROR: input file could not be mapped");
+        }
+        madvise(mapping, buffer.size, MADV_SEQUENTIAL);
+        buffer.data = static_cast<const char*>(mapping);
+        buffer.mapped = true;
+    }
+    close(descriptor);
+    return buffer;
+}
+
+SourceBuffer SourceBuffer::from_string(std::string text) {
+    SourceBuffer buffer;
+    buffer.owned = std::move(text);
+    buffer.data = buffer.owned.data();
+    buffer.size = buffer.owned.size();
+    return buffer;
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        mapped = std::exchange(other.mapped, false);
+        size = std::exchange(other.size, 0);
+        if (mapped) {
+            data = std::exchange(other.data, nullptr);
+        } else {
+            owned = std::move(other.owned);
+            data = owned.data();
+            other.data = nullptr;
+        }
+    }
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer() {
+    release();
+}
+
+void SourceBuffer::release() {
+    if (mapped) {
+        munmap(const_cast<char*>(data), size);
+    }
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    owned.clear();
+}
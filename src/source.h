@@ -0,0 +1,34 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// The text of a script. Files are memory-mapped read-only rather than read
+// into a string, and scripts that do not live in a file can be handed over
+// as a string. Tokens are views into this text, so it must outlive them.
+class SourceBuffer {
+public:
+    static SourceBuffer map_file(const char* path);
+    static SourceBuffer from_string(std::string text);
+
+    SourceBuffer(SourceBuffer&& other) noexcept;
+    SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    ~SourceBuffer();
+
+    std::string_view text() const { return {data, size}; }
+
+private:
+    SourceBuffer() = default;
+    void release();
+
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::string owned;
+};
+
+#endif
@@ -1,11 +1,11 @@
 #include "token.h"
 
-Token::Token(std::string val, TokenType t) {
+Token::Token(std::string_view val, TokenType t) {
     value = val;
     type = t;
 }
 
-std::string Token::get_value() const {
+std::string_view Token::get_value() const {
     return value;
 }
 
@@ -1,9 +1,15 @@
 #ifndef LEXEMES_H
 #define LEXEMES_H
 
+#include <cstdint>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
 
-enum class TokenType {
+#include "errors.h"
+
+enum class TokenType : uint8_t {
 
     // Operators
     Plus,
@@ -43,16 +49,80 @@ enum class TokenType {
     Eof
 };
 
+// A token's text is a view into the SourceBuffer it was scanned from.
 class Token {
 public:
-    Token(std::string val, TokenType type);
-    std::string get_value() const;
+    Token(std::string_view val, TokenType type);
+    std::string_view get_value() const;
     TokenType get_type() const;
     static std::string get_type_string(TokenType type);
 
 private:
-    std::string value;
+    std::string_view value;
     TokenType type;
 };
 
+// A single scanned token and where it starts. Lines and columns count from 1.
+struct Lexeme {
+    TokenType kind = TokenType::Eof;
+    std::string_view text;
+    uint32_t line = 0;
+    uint32_t column = 0;
+};
+
+// Every token of a script, stored as parallel arrays. Token text is the span
+// [offset, offset + length) of the source the stream was scanned from, which
+// must outlive the stream. Lines and columns count from 1.
+class TokenStream {
+public:
+    explicit TokenStream(std::string_view source) : source(source) {}
+
+    void reserve(size_t count) {
+        kinds.reserve(count);
+        offsets.reserve(count);
+        lengths.reserve(count);
+        lines.reserve(count);
+        columns.reserve(count);
+    }
+
+    // Appends the tokens and errors of another stream over the same source.
+    void append(const TokenStream& other) {
+        kinds.insert(kinds.end(), other.kinds.begin(), other.kinds.end());
+        offsets.insert(offsets.end(), other.offsets.begin(), other.offsets.end());
+        lengths.insert(lengths.end(), other.lengths.begin(), other.lengths.end());
+        lines.insert(lines.end(), other.lines.begin(), other.lines.end());
+        columns.insert(columns.end(), other.columns.begin(), other.columns.end());
+        scan_errors.append(other.scan_errors);
+    }
+
+    void add(TokenType kind, std::string_view text, uint32_t line, uint32_t column) {
+        kinds.push_back(kind);
+        offsets.push_back(static_cast<uint32_t>(text.data() - source.data()));
+        lengths.push_back(static_cast<uint32_t>(text.size()));
+        lines.push_back(line);
+        columns.push_back(column);
+    }
+
+    size_t size() const { return kinds.size(); }
+    TokenType kind(size_t index) const { return kinds[index]; }
+    uint32_t line(size_t index) const { return lines[index]; }
+    uint32_t column(size_t index) const { return columns[index]; }
+    std::string_view text(size_t index) const {
+        return source.substr(offsets[index], lengths[index]);
+    }
+
+    // Characters that start no token, which are left out of the stream.
+    ErrorTracker& errors() { return scan_errors; }
+    const ErrorTracker& errors() const { return scan_errors; }
+
+private:
+    std::string_view source;
+    std::vector<TokenType> kinds;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> lines;
+    std::vector<uint32_t> columns;
+    ErrorTracker scan_errors;
+};
+
 #endif 
@@ -0,0 +1,316 @@
+#include "transpiler.h"
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+#ifndef IOWA_RUNTIME_DIR
+#define IOWA_RUNTIME_DIR "runtime"
+#endif
+
+namespace {
+
+// A C++ string literal with the same bytes as `text`.
+std::string quoted(std::string_view text) {
+    std::string literal = "\"";
+    for (char character : text) {
+        unsigned char byte = static_cast<unsigned char>(character);
+        if (character == '"' || character == '\\') {
+            literal += '\\';
+            literal += character;
+        } else if (byte < 0x20 || byte >= 0x7f) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\%03o", byte);
+            literal += escape;
+        } else {
+            literal += character;
+        }
+    }
+    return literal + "\"";
+}
+
+const char* operator_name(TokenType op) {
+    switch (op) {
+        case TokenType::Plus:              return "Plus";
+        case TokenType::Minus:             return "Minus";
+        case TokenType::Multiply:          return "Multiply";
+        case TokenType::Divide:            return "Divide";
+        case TokenType::GreaterThan:       return "GreaterThan";
+        case TokenType::GreaterEqualsThan: return "GreaterEqualsThan";
+        case TokenType::LessThan:          return "LessThan";
+        case TokenType::LessEqualsThan:    return "LessEqualsThan";
+        case TokenType::EqualsEquals:      return "EqualsEquals";
+        case TokenType::NotEqual:          return "NotEqual";
+        case TokenType::And:               return "And";
+        case TokenType::Or:                return "Or";
+        default:
+            throw std::runtime_error("Unsupported binary operator: " + Token::get_type_string(op));
+    }
+}
+
+}
+
+std::string Transpiler::translate(const Ast& program) {
+    ast = &program;
+    code.clear();
+    scopes.clear();
+    indentation = 0;
+    string_indices.clear();
+    strings.clear();
+
+    emit_block(ast->node(ast->root), true);
+
+    std::string translated =
+        "// Translated from Iowa by Iowa --emit-cpp.\n"
+        "#include \"iowa_runtime.h\"\n\n";
+    if (!strings.empty()) {
+        translated += "static constexpr std::string_view strings[] = {\n";
+        for (const std::string* text : strings) {
+            translated += "    {" + quoted(*text) + ", " + std::to_string(text->size()) + "},\n";
+        }
+        translated += "};\n\n";
+    }
+    translated += "static void script() ";
+    translated += code;
+    translated += "\nint main() {\n    return iowa::run(script);\n}\n";
+    return translated;
+}
+
+void Transpiler::emit_declaration(NodeIndex index) {
+    if (index == no_node) {
+        throw std::runtime_error("null declaration encountered during translation");
+    }
+
+    const Node& declaration = ast->node(index);
+    begin_line();
+    if (declaration.kind == NodeKind::DynamicDeclaration) {
+        emit_variable(scopes.size() - 1, static_cast<int>(declaration.third));
+        code += " = ";
+        emit_expression(declaration.second);
+        code += ";\n";
+    } else {
+        emit_statement(declaration);
+    }
+}
+
+void Transpiler::emit_statement(const Node& declaration) {
+    switch (declaration.kind) {
+        case NodeKind::PrintStatement:
+            code += "iowa::print(";
+            emit_expression(declaration.first);
+            code += ");\n";
+            break;
+        case NodeKind::ExpressionStatement:
+            code += "(void)";
+            emit_expression(declaration.first);
+            code += ";\n";
+            break;
+        case NodeKind::Block:
+            emit_block(declaration, true);
+            break;
+        case NodeKind::If:
+            emit_if(declaration);
+            break;
+        case NodeKind::Loop:
+            emit_loop(declaration);
+            break;
+        default:
+            throw std::runtime_error("Unknown statement type");
+    }
+}
+
+// Opens a C++ block at the current position. A block with a scope of its
+// own declares its variables there, all undefined until assigned.
+void Transpiler::emit_block(const Node& block, bool use_new_scope) {
+    code += "{\n";
+    indentation++;
+    if (use_new_scope) {
+        scopes.push_back(block.third);
+        uint32_t slot_count = ast->scopes[block.third].slot_count;
+        if (slot_count > 0) {
+            begin_line();
+            code += "iowa::Value s" + std::to_string(block.third) + "[" +
+                    std::to_string(slot_count) + "];\n";
+        }
+    }
+
+    for (NodeIndex declaration : ast->block_children(block)) {
+        emit_declaration(declaration);
+    }
+
+    if (use_new_scope) {
+        scopes.pop_back();
+    }
+    indentation--;
+    begin_line();
+    code += "}\n";
+}
+
+void Transpiler::emit_if(const Node& if_stmnt) {
+    code += "if (iowa::condition(";
+    emit_expression(if_stmnt.first);
+    code += ", \"If condition must be boolean\")) ";
+    emit_block(ast->node(if_stmnt.second), true);
+    if (if_stmnt.third != no_node) {
+        code.pop_back();
+        code += " else ";
+        emit_block(ast->node(if_stmnt.third), true);
+    }
+}
+
+// The body runs once more after the condition turns false, as in the tree
+// walker. It shares the enclosing scope.
+void Transpiler::emit_loop(const Node& loop) {
+    code += "for (bool running = true; running;) {\n";
+    indentation++;
+    begin_line();
+    code += "running = iowa::condition(";
+    emit_expression(loop.first);
+    code += ", \"Loop condition must be boolean\");\n";
+    begin_line();
+    emit_block(ast->node(loop.second), false);
+    indentation--;
+    begin_line();
+    code += "}\n";
+}
+
+void Transpiler::emit_expression(NodeIndex index) {
+    if (index == no_node) {
+        throw std::runtime_error("Null expression encountered during translation");
+    }
+
+    const Node& expr = ast->node(index);
+    switch (expr.kind) {
+        case NodeKind::Binary:
+            emit_binary(expr);
+            break;
+        case NodeKind::Identifier:
+            emit_identifier(expr);
+            break;
+        case NodeKind::Literal:
+            emit_literal(expr);
+            break;
+        default:
+            throw std::runtime_error("Unknown expression type");
+    }
+}
+
+void Transpiler::emit_binary(const Node& binary) {
+    code += "iowa::binary<iowa::Op::";
+    code += operator_name(binary.op);
+    code += ">({";
+    emit_expression(binary.first);
+    code += ", ";
+    emit_expression(binary.second);
+    code += "})";
+}
+
+// A binding that is not definite may still be unassigned when it is read,
+// in which case the read falls through the scopes the resolver recorded as
+// shadowed, exactly as Environment::get_variable_value does.
+void Transpiler::emit_identifier(const Node& identifier) {
+    Binding binding = ast->binding(identifier);
+    std::string missing = "iowa::undefined_variable(" + quoted(ast->name(identifier.first)) + ")";
+    if (binding.slot < 0) {
+        code += missing;
+        return;
+    }
+
+    size_t level = scopes.size() - 1 - binding.depth;
+    if (binding.definite) {
+        emit_variable(level, binding.slot);
+        return;
+    }
+
+    int slot = binding.slot;
+    code += "(";
+    for (;;) {
+        code += "!";
+        emit_variable(level, slot);
+        code += ".is_undefined() ? ";
+        emit_variable(level, slot);
+        code += " : ";
+
+        const Binding& outer = ast->scope_slots(scopes[level])[slot];
+        if (outer.slot < 0) {
+            break;
+        }
+        level -= outer.depth;
+        slot = outer.slot;
+    }
+    code += missing + ")";
+}
+
+void Transpiler::emit_literal(const Node& literal) {
+    const Value& constant = ast->constants[literal.first];
+    if (constant.is_int()) {
+        // -2147483648 is the negation of a literal too big for int, which
+        // would make iowa::Value(bool) as good a match as iowa::Value(int).
+        int number = constant.as_int();
+        code += number == INT_MIN
+            ? "iowa::Value(" + std::to_string(INT_MIN + 1) + " - 1)"
+            : "iowa::Value(" + std::to_string(number) + ")";
+    } else if (constant.is_bool()) {
+        code += constant.as_bool() ? "iowa::Value(true)" : "iowa::Value(false)";
+    } else if (constant.is_string()) {
+        auto [entry, added] = string_indices.try_emplace(&constant.as_string(), strings.size());
+        if (added) {
+            strings.push_back(&constant.as_string());
+        }
+        code += "iowa::Value::string(strings[" + std::to_string(entry->second) + "])";
+    } else {
+        code += "iowa::Value()";
+    }
+}
+
+// Loop bodies share their enclosing scope but still nest a C++ block deeper,
+// so a level names an entry of `scopes` rather than a C++ block.
+void Transpiler::emit_variable(size_t level, int slot) {
+    code += "s" + std::to_string(scopes[level]) + "[" + std::to_string(slot) + "]";
+}
+
+void Transpiler::begin_line() {
+    code.append(4 * indentation, ' ');
+}
+
+// The compiler is run directly rather than through a shell, so paths and
+// IOWA_CXX are passed on as they are, whatever characters they contain.
+void compile_cpp(const std::string& cpp_path, const std::string& binary_path) {
+    const char* compiler = std::getenv("IOWA_CXX");
+    std::string program = compiler ? compiler : "clang++";
+    std::vector<std::string> arguments = {
+        program, "-std=c++20", "-O2", "-I", IOWA_RUNTIME_DIR, "-o", binary_path, cpp_path
+    };
+    std::vector<char*> argv;
+    for (std::string& argument : arguments) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t child;
+    int error = posix_spawnp(&child, program.c_str(), nullptr, nullptr, argv.data(), environ);
+    if (error != 0) {
+        throw std::runtime_error("ERROR: could not run " + program + ": " + std::strerror(error));
+    }
+    int status;
+    while (waitpid(child, &status, 0) < 0) {
+        if (errno != EINTR) {
+            throw std::runtime_error("ERROR: lost track of " + program + ": " + std::strerror(errno));
+        }
+    }
+    if (WIFSIGNALED(status)) {
+        throw std::runtime_error("ERROR: " + program + " was killed by signal " +
+                                 std::to_string(WTERMSIG(status)));
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("ERROR: " + program + " failed with exit status " +
+                                 std::to_string(WEXITSTATUS(status)));
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef TRANSPILER_H
+#define TRANSPILER_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+
+// Translates a resolved Ast into a standalone C++ program built on
+// runtime/iowa_runtime.h. Every scope becomes a local array of values and
+// every variable an element of one, found through the resolver's bindings,
+// so the compiled program does no name lookups at all.
+class Transpiler {
+public:
+    std::string translate(const Ast& program);
+
+private:
+    void emit_declaration(NodeIndex declaration);
+    void emit_statement(const Node& declaration);
+    void emit_block(const Node& block, bool use_new_scope);
+    void emit_if(const Node& if_stmnt);
+    void emit_loop(const Node& loop);
+
+    void emit_expression(NodeIndex expr);
+    void emit_binary(const Node& binary);
+    void emit_identifier(const Node& identifier);
+    void emit_literal(const Node& literal);
+
+    void emit_variable(size_t level, int slot);
+    void begin_line();
+
+    const Ast* ast = nullptr;
+    std::string code;
+    // Scopes of the blocks being translated, outermost first.
+    std::vector<uint32_t> scopes;
+    size_t indentation = 0;
+    // Each distinct string literal is emitted once, so equal strings share a
+    // pointer in the compiled program as they do in the interpreter.
+    std::unordered_map<const std::string*, size_t> string_indices;
+    std::vector<const std::string*> strings;
+};
+
+// Builds a native executable from C++ written by Transpiler. Uses the
+// compiler named by IOWA_CXX, or clang++, found on PATH. Throws
+// std::runtime_error when the compiler cannot be started, exits with a
+// non-zero status or is killed.
+void compile_cpp(const std::string& cpp_path, const std::string& binary_path);
+
+#endif
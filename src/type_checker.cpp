@@ -0,0 +1,238 @@
+#include "type_checker.h"
+#include <stdexcept>
+
+namespace {
+
+const std::string sample_text;
+
+}
+
+// A stand-in for a value of one type. Running the real operator on them
+// keeps the checker's idea of which combinations fail in step with the
+// runtime, error messages included.
+Value TypeChecker::sample(Types type) {
+    switch (type) {
+        case int_type:  return Value(1);
+        case bool_type: return Value(true);
+        default:        return Value::string(&sample_text);
+    }
+}
+
+void TypeChecker::check(Ast& program, ErrorTracker& tracker) {
+    ast = &program;
+    errors = &tracker;
+    frames.clear();
+    frame_scopes.clear();
+    recording = true;
+    certain = true;
+    check_block(ast->node(ast->root), true);
+}
+
+void TypeChecker::begin(Ast& program, ErrorTracker& tracker) {
+    ast = &program;
+    errors = &tracker;
+    frames.assign(1, {});
+    frame_scopes.assign(1, 0);
+    recording = true;
+    certain = true;
+}
+
+void TypeChecker::check_top_level(NodeIndex declaration) {
+    frames.front().resize(ast->scopes[0].slot_count, undefined_type);
+    check_declaration(declaration);
+}
+
+void TypeChecker::check_declaration(NodeIndex index) {
+    Node& declaration = ast->node(index);
+    switch (declaration.kind) {
+        case NodeKind::DynamicDeclaration:
+            frames.back()[declaration.third] = infer(declaration.second);
+            break;
+        case NodeKind::PrintStatement:
+        case NodeKind::ExpressionStatement:
+            infer(declaration.first);
+            break;
+        case NodeKind::Block:
+            check_block(declaration, true);
+            break;
+        case NodeKind::If:
+            check_if(declaration);
+            break;
+        case NodeKind::Loop:
+            check_loop(declaration);
+            break;
+        default:
+            break;
+    }
+}
+
+// Blocks can only assign their own scope, so leaving one never changes what
+// the enclosing scopes hold.
+void TypeChecker::check_block(const Node& block, bool use_new_scope) {
+    if (use_new_scope) {
+        frames.emplace_back(ast->scopes[block.third].slot_count, undefined_type);
+        frame_scopes.push_back(block.third);
+    }
+    for (NodeIndex declaration : ast->block_children(block)) {
+        check_declaration(declaration);
+    }
+    if (use_new_scope) {
+        frames.pop_back();
+        frame_scopes.pop_back();
+    }
+}
+
+void TypeChecker::check_if(Node& if_stmnt) {
+    check_condition(if_stmnt, "If condition must be boolean");
+    certain = false;
+    check_block(ast->node(if_stmnt.second), true);
+    if (if_stmnt.third != no_node) {
+        check_block(ast->node(if_stmnt.third), true);
+    }
+}
+
+// The body runs in the enclosing scope, at least once, and may run again
+// with the types it left behind. It is re-checked until the types at the
+// top of the loop stop growing, then once more to record what holds on
+// every iteration. Only the first test of the condition is certain to run;
+// the types it is finally checked against include the first iteration's,
+// so whatever fails on all of them fails on the way in as well.
+void TypeChecker::check_loop(Node& loop) {
+    const Node& body = ast->node(loop.second);
+    bool entry_certain = certain;
+    bool outer_recording = recording;
+    recording = false;
+    std::vector<Types> entry;
+    do {
+        entry = frames.back();
+        check_condition(loop, "Loop condition must be boolean");
+        check_block(body, false);
+        for (size_t slot = 0; slot < entry.size(); slot++) {
+            frames.back()[slot] |= entry[slot];
+        }
+    } while (frames.back() != entry);
+    recording = outer_recording;
+
+    certain = entry_certain;
+    check_condition(loop, "Loop condition must be boolean");
+    certain = false;
+    check_block(body, false);
+    frames.back() = entry;
+}
+
+void TypeChecker::check_condition(Node& statement, const char* message) {
+    Types condition = infer(statement.first);
+    if (!recording) {
+        return;
+    }
+    if (condition == bool_type) {
+        statement.flags |= boolean_condition;
+    } else if (certain && condition != 0 && !(condition & bool_type)) {
+        report(statement.first, message);
+    }
+}
+
+// An expression's types never include undefined_type: reading an unassigned
+// variable fails instead. No types at all means evaluating it always fails.
+TypeChecker::Types TypeChecker::infer(NodeIndex index) {
+    Node& expr = ast->node(index);
+    switch (expr.kind) {
+        case NodeKind::Binary:
+            return infer_binary(expr, index);
+        case NodeKind::Identifier:
+            return infer_identifier(expr);
+        case NodeKind::Literal: {
+            const Value& constant = ast->constants[expr.first];
+            return constant.is_int() ? int_type
+                 : constant.is_bool() ? bool_type
+                 : constant.is_string() ? string_type
+                 : 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+TypeChecker::Types TypeChecker::infer_binary(Node& binary, NodeIndex index) {
+    Types left = infer(binary.first);
+    Types right = infer(binary.second);
+    if (left == 0 || right == 0) {
+        return 0;
+    }
+
+    Types result = 0;
+    std::string failure;
+    for (Types left_type = int_type; left_type <= string_type; left_type <<= 1) {
+        for (Types right_type = int_type; right_type <= string_type; right_type <<= 1) {
+            if (!(left & left_type) || !(right & right_type)) {
+                continue;
+            }
+            try {
+                Value value = binary_operation(binary.op, sample(left_type), sample(right_type));
+                result |= value.is_int() ? int_type : value.is_bool() ? bool_type : string_type;
+            } catch (const std::runtime_error& error) {
+                if (failure.empty()) {
+                    failure = error.what();
+                }
+            }
+        }
+    }
+
+    if (recording) {
+        if (left == int_type && right == int_type) {
+            binary.flags |= int_operands;
+        }
+        if (result == 0 && certain) {
+            report(index, failure);
+        }
+    }
+    if (!failure.empty() || (binary.op == TokenType::Divide && !safe_divisor(binary.second))) {
+        certain = false;
+    }
+    return result;
+}
+
+// Reads that are not definite fall through the shadowed scopes until one
+// may hold a value, as Environment::get_variable_value does at runtime.
+TypeChecker::Types TypeChecker::infer_identifier(const Node& identifier) {
+    Binding binding = ast->binding(identifier);
+    if (binding.slot < 0) {
+        certain = false;
+        return 0;
+    }
+
+    size_t level = frames.size() - 1 - binding.depth;
+    int slot = binding.slot;
+    Types types = 0;
+    for (;;) {
+        Types held = frames[level][slot];
+        types |= held & ~undefined_type;
+        if (binding.definite || !(held & undefined_type)) {
+            break;
+        }
+        const Binding& outer = ast->scope_slots(frame_scopes[level])[slot];
+        if (outer.slot < 0) {
+            // The read fails when no scope has assigned the variable yet.
+            certain = false;
+            break;
+        }
+        level -= outer.depth;
+        slot = outer.slot;
+    }
+    return types;
+}
+
+// An int literal other than 0 and -1. Dividing by anything else may fail,
+// on zero or on INT_MIN / -1.
+bool TypeChecker::safe_divisor(NodeIndex expr) const {
+    const Node& node = ast->node(expr);
+    if (node.kind != NodeKind::Literal) {
+        return false;
+    }
+    const Value& constant = ast->constants[node.first];
+    return constant.is_int() && constant.as_int() != 0 && constant.as_int() != -1;
+}
+
+void TypeChecker::report(NodeIndex at, const std::string& message) {
+    errors->add_error(message, "", static_cast<int>(ast->position(at).line));
+}
@@ -0,0 +1,65 @@
+#ifndef TYPE_CHECKER_H
+#define TYPE_CHECKER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "errors.h"
+
+// Works out which types every variable and expression can have, following
+// the statements of a resolved program in order, and flags what it proves:
+// Binary nodes whose operands are always ints get int_operands, If and Loop
+// nodes whose condition is always a boolean get boolean_condition. An
+// operator or condition that fails on every type it can see is a type
+// error, reported before the program runs, but only where it is certain to
+// run: in the straight-line code before the first if or loop, up to the
+// first thing that may fail at runtime. Anywhere else it is left to the
+// runtime, since the script may never get there.
+class TypeChecker {
+public:
+    void check(Ast& ast, ErrorTracker& errors);
+
+    // Checks a program one top-level declaration at a time, as a streaming
+    // parser produces them. Global variables keep their types in between.
+    void begin(Ast& ast, ErrorTracker& errors);
+    void check_top_level(NodeIndex declaration);
+
+private:
+    // A set of types, one bit each. A slot holding undefined_type may not
+    // have been assigned yet.
+    using Types = uint8_t;
+    static constexpr Types undefined_type = 1;
+    static constexpr Types int_type = 2;
+    static constexpr Types bool_type = 4;
+    static constexpr Types string_type = 8;
+
+    void check_declaration(NodeIndex declaration);
+    void check_block(const Node& block, bool use_new_scope);
+    void check_if(Node& if_stmnt);
+    void check_loop(Node& loop);
+    void check_condition(Node& statement, const char* message);
+
+    Types infer(NodeIndex expr);
+    Types infer_binary(Node& binary, NodeIndex index);
+    Types infer_identifier(const Node& identifier);
+
+    static Value sample(Types type);
+    bool safe_divisor(NodeIndex expr) const;
+    void report(NodeIndex at, const std::string& message);
+
+    Ast* ast = nullptr;
+    ErrorTracker* errors = nullptr;
+    // What each slot of each scope being checked can hold, outermost first,
+    // with the scope each belongs to.
+    std::vector<std::vector<Types>> frames;
+    std::vector<uint32_t> frame_scopes;
+    // Off while a loop body is iterated to a fixed point; the body is
+    // checked once more afterwards to record flags and errors.
+    bool recording = true;
+    // Whether the code being checked is certain to run.
+    bool certain = true;
+};
+
+#endif
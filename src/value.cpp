@@ -0,0 +1,34 @@
+#include "value.h"
+
+void fail_binary(TokenType op, const Value& left, const Value& right) {
+    if (left.type() != right.type()) {
+        throw std::runtime_error(
+            "Type mismatch in binary expression: " +
+            Token::get_type_string(op));
+    }
+
+    switch (left.type()) {
+        case Value::Type::Int:
+            throw std::runtime_error("Unsupported integer op: " +
+                                     Token::get_type_string(op));
+        case Value::Type::Bool:
+            throw std::runtime_error("Unsupported boolean op: " +
+                                     Token::get_type_string(op));
+        case Value::Type::String:
+            throw std::runtime_error("Unsupported string op: " +
+                                     Token::get_type_string(op));
+        default:
+            throw std::runtime_error(
+                "Type mismatch in binary expression: " +
+                Token::get_type_string(op));
+    }
+}
+
+Value binary_mixed(TokenType op, const Value& left, const Value& right) {
+    if (left.is_bool() && right.is_bool()) {
+        return bool_binary(op, left.as_bool(), right.as_bool());
+    } else if (left.is_string() && right.is_string()) {
+        return string_binary(op, left, right);
+    }
+    fail_binary(op, left, right);
+}
@@ -0,0 +1,129 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "token.h"
+
+// A runtime value: a one byte type tag and an eight byte payload. Strings are
+// held by pointer to text interned in the program's Interner, which outlives
+// every value referring to it. Copying a Value is a plain 16 byte copy and
+// never allocates, and two string values are equal exactly when they point
+// at the same interned text.
+class Value {
+public:
+    enum class Type : uint8_t {
+        Undefined,
+        Int,
+        Double,
+        String,
+        Bool
+    };
+
+    Value() : tag(Type::Undefined), integer(0) {}
+    Value(int v) : tag(Type::Int), integer(v) {}
+    Value(double v) : tag(Type::Double), real(v) {}
+    Value(bool v) : tag(Type::Bool), boolean(v) {}
+
+    // Pointers would otherwise silently convert to bool.
+    template<typename T>
+    Value(T*) = delete;
+
+    static Value string(const std::string* v) {
+        Value value;
+        value.tag = Type::String;
+        value.text = v;
+        return value;
+    }
+
+    Type type() const { return tag; }
+    bool is_undefined() const { return tag == Type::Undefined; }
+    bool is_int() const { return tag == Type::Int; }
+    bool is_bool() const { return tag == Type::Bool; }
+    bool is_string() const { return tag == Type::String; }
+
+    int as_int() const { return integer; }
+    double as_double() const { return real; }
+    bool as_bool() const { return boolean; }
+    const std::string& as_string() const { return *text; }
+
+private:
+    Type tag;
+    union {
+        int integer;
+        double real;
+        bool boolean;
+        const std::string* text;
+    };
+};
+
+static_assert(sizeof(Value) == 16);
+static_assert(std::is_trivially_copyable_v<Value>);
+
+[[noreturn]] void fail_binary(TokenType op, const Value& left, const Value& right);
+Value binary_mixed(TokenType op, const Value& left, const Value& right);
+
+// Operators on two operands already known to be ints, bools or strings.
+// The int case is on every arithmetic path; with several callers the
+// compiler would otherwise call it out of line.
+// Addition, subtraction and multiplication wrap around in two's complement,
+// done on unsigned values so overflow is defined. The one quotient that does
+// not fit, INT_MIN / -1, is an error like division by zero, since the
+// hardware traps on it.
+[[gnu::always_inline]] inline Value int_binary(TokenType op, int l, int r) {
+    switch (op) {
+        case TokenType::Plus:             return static_cast<int>(static_cast<unsigned>(l) + static_cast<unsigned>(r));
+        case TokenType::Minus:            return static_cast<int>(static_cast<unsigned>(l) - static_cast<unsigned>(r));
+        case TokenType::Multiply:         return static_cast<int>(static_cast<unsigned>(l) * static_cast<unsigned>(r));
+        case TokenType::Divide:
+            if (r == 0) throw std::runtime_error("Division by zero");
+            if (r == -1 && l == INT_MIN) throw std::runtime_error("Integer overflow in division");
+            return l / r;
+
+        case TokenType::GreaterThan:      return l > r;
+        case TokenType::GreaterEqualsThan:return l >= r;
+        case TokenType::LessThan:         return l < r;
+        case TokenType::LessEqualsThan:   return l <= r;
+
+        case TokenType::EqualsEquals:     return l == r;
+        case TokenType::NotEqual:         return l != r;
+
+        default:
+            fail_binary(op, l, r);
+    }
+}
+
+inline Value bool_binary(TokenType op, bool l, bool r) {
+    switch (op) {
+        case TokenType::And:              return l && r;
+        case TokenType::Or:               return l || r;
+        case TokenType::EqualsEquals:     return l == r;
+        case TokenType::NotEqual:         return l != r;
+        default:                          fail_binary(op, l, r);
+    }
+}
+
+// Interned strings are equal exactly when they are the same string.
+inline Value string_binary(TokenType op, const Value& left, const Value& right) {
+    switch (op) {
+        case TokenType::EqualsEquals:     return &left.as_string() == &right.as_string();
+        case TokenType::NotEqual:         return &left.as_string() != &right.as_string();
+        default:                          fail_binary(op, left, right);
+    }
+}
+
+// Applies a binary operator. Integer operands take the inline fast path; every
+// other combination goes through binary_mixed.
+inline Value binary_operation(TokenType op, const Value& left, const Value& right) {
+    if (left.is_int() && right.is_int()) {
+        return int_binary(op, left.as_int(), right.as_int());
+    }
+    return binary_mixed(op, left, right);
+}
+
+#endif
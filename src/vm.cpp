@@ -0,0 +1,172 @@
+#include "vm.h"
+#include <iostream>
+#include <stdexcept>
+
+VM::VM(OutputSink& output, Allocation allocation)
+    : output(output), memory(allocation), stack(memory.resource()), environment(memory.resource()) {}
+
+VM::~VM() = default;
+
+void VM::run(const Chunk& chunk) {
+    const uint8_t* code = chunk.code.data();
+    const uint8_t* ip = code;
+
+    stack.resize(chunk.max_stack);
+    // One past the value on top of the stack.
+    Value* top = stack.data();
+    environment.reset(chunk.scope_slots(chunk.global_scope));
+
+    // Counted in locals so the hot loop keeps them in registers.
+    uint64_t steps = 0;
+    uint64_t lookups = 0;
+    auto binary = [&top](TokenType op) {
+        top--;
+        top[-1] = binary_operation(op, top[-1], top[0]);
+    };
+    auto int_binary_op = [&top](TokenType op) {
+        top--;
+        top[-1] = int_binary(op, top[-1].as_int(), top[0].as_int());
+    };
+    auto int_constant_op = [&top, &ip, &chunk](TokenType op) {
+        int right = chunk.constants[Chunk::read_operand(ip)].as_int();
+        ip += sizeof(uint32_t);
+        top[-1] = int_binary(op, top[-1].as_int(), right);
+    };
+
+    try {
+        for (;;) {
+            OpCode op = static_cast<OpCode>(*ip++);
+            steps++;
+
+            switch (op) {
+                case OpCode::Constant:
+                    *top++ = chunk.constants[Chunk::read_operand(ip)];
+                    ip += sizeof(uint32_t);
+                    break;
+
+                case OpCode::GetLocal:
+                    lookups++;
+                    *top++ = environment.local(static_cast<int>(Chunk::read_operand(ip + sizeof(uint32_t))),
+                                               static_cast<int>(Chunk::read_operand(ip)));
+                    ip += 2 * sizeof(uint32_t);
+                    break;
+
+                case OpCode::GetVariable: {
+                    lookups++;
+                    const VariableRef& variable = chunk.variables[Chunk::read_operand(ip)];
+                    const Value* value = environment.get_variable_value(variable.binding);
+                    if (!value) {
+                        throw std::runtime_error("Error: variable '" + variable.name + "' does not exist");
+                    }
+                    *top++ = *value;
+                    ip += sizeof(uint32_t);
+                    break;
+                }
+
+                case OpCode::SetLocal:
+                    environment.add_variable(static_cast<int>(Chunk::read_operand(ip)), *--top);
+                    ip += sizeof(uint32_t);
+                    break;
+
+                case OpCode::UndefinedVariable:
+                    throw std::runtime_error(
+                        "Error: variable '" + chunk.variables[Chunk::read_operand(ip)].name + "' does not exist");
+
+                case OpCode::Add:          binary(TokenType::Plus); break;
+                case OpCode::Subtract:     binary(TokenType::Minus); break;
+                case OpCode::Multiply:     binary(TokenType::Multiply); break;
+                case OpCode::Divide:       binary(TokenType::Divide); break;
+                case OpCode::Greater:      binary(TokenType::GreaterThan); break;
+                case OpCode::GreaterEqual: binary(TokenType::GreaterEqualsThan); break;
+                case OpCode::Less:         binary(TokenType::LessThan); break;
+                case OpCode::LessEqual:    binary(TokenType::LessEqualsThan); break;
+                case OpCode::Equal:        binary(TokenType::EqualsEquals); break;
+                case OpCode::NotEqual:     binary(TokenType::NotEqual); break;
+                case OpCode::And:          binary(TokenType::And); break;
+                case OpCode::Or:           binary(TokenType::Or); break;
+
+                case OpCode::AddInt:          int_binary_op(TokenType::Plus); break;
+                case OpCode::SubtractInt:     int_binary_op(TokenType::Minus); break;
+                case OpCode::MultiplyInt:     int_binary_op(TokenType::Multiply); break;
+                case OpCode::DivideInt:       int_binary_op(TokenType::Divide); break;
+                case OpCode::GreaterInt:      int_binary_op(TokenType::GreaterThan); break;
+                case OpCode::GreaterEqualInt: int_binary_op(TokenType::GreaterEqualsThan); break;
+                case OpCode::LessInt:         int_binary_op(TokenType::LessThan); break;
+                case OpCode::LessEqualInt:    int_binary_op(TokenType::LessEqualsThan); break;
+                case OpCode::EqualInt:        int_binary_op(TokenType::EqualsEquals); break;
+                case OpCode::NotEqualInt:     int_binary_op(TokenType::NotEqual); break;
+
+                case OpCode::AddIntConstant:          int_constant_op(TokenType::Plus); break;
+                case OpCode::SubtractIntConstant:     int_constant_op(TokenType::Minus); break;
+                case OpCode::MultiplyIntConstant:     int_constant_op(TokenType::Multiply); break;
+                case OpCode::DivideIntConstant:       int_constant_op(TokenType::Divide); break;
+                case OpCode::GreaterIntConstant:      int_constant_op(TokenType::GreaterThan); break;
+                case OpCode::GreaterEqualIntConstant: int_constant_op(TokenType::GreaterEqualsThan); break;
+                case OpCode::LessIntConstant:         int_constant_op(TokenType::LessThan); break;
+                case OpCode::LessEqualIntConstant:    int_constant_op(TokenType::LessEqualsThan); break;
+                case OpCode::EqualIntConstant:        int_constant_op(TokenType::EqualsEquals); break;
+                case OpCode::NotEqualIntConstant:     int_constant_op(TokenType::NotEqual); break;
+
+                case OpCode::Print:
+                    output.print_value(*--top);
+                    break;
+
+                case OpCode::Pop:
+                    top--;
+                    break;
+
+                case OpCode::PushScope:
+                    environment.enter(chunk.scope_slots(Chunk::read_operand(ip)));
+                    ip += sizeof(uint32_t);
+                    break;
+
+                case OpCode::PopScope:
+                    environment.leave();
+                    break;
+
+                case OpCode::Jump:
+                    ip = code + Chunk::read_operand(ip);
+                    break;
+
+                case OpCode::JumpIfFalse: {
+                    Value condition = *--top;
+                    if (!condition.is_bool()) {
+                        throw std::runtime_error("If condition must be boolean");
+                    }
+                    if (condition.as_bool()) {
+                        ip += sizeof(uint32_t);
+                    } else {
+                        ip = code + Chunk::read_operand(ip);
+                    }
+                    break;
+                }
+
+                case OpCode::CheckLoopCondition:
+                    if (!top[-1].is_bool()) {
+                        throw std::runtime_error("Loop condition must be boolean");
+                    }
+                    break;
+
+                case OpCode::LoopIfTrue:
+                    if ((*--top).as_bool()) {
+                        ip = code + Chunk::read_operand(ip);
+                    } else {
+                        ip += sizeof(uint32_t);
+                    }
+                    break;
+
+                case OpCode::Halt:
+                    stats.steps += steps;
+                    stats.lookups += lookups;
+                    return;
+
+                default:
+                    throw std::runtime_error("Unknown opcode");
+            }
+        }
+    } catch (...) {
+        stats.steps += steps;
+        stats.lookups += lookups;
+        throw;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef VM_H
+#define VM_H
+
+#include <vector>
+
+#include "bytecode.h"
+#include "environment.h"
+#include "memory.h"
+#include "output.h"
+#include "profile.h"
+
+class VM {
+public:
+    // Whatever the program prints goes to `output`. The stack and scopes
+    // are allocated as `allocation` says.
+    explicit VM(OutputSink& output, Allocation allocation = Allocation::Global);
+    ~VM();
+
+    void run(const Chunk& chunk);
+
+    const ExecutionStats& statistics() const { return stats; }
+
+private:
+    OutputSink& output;
+    // Declared before the containers that allocate from it.
+    RuntimeMemory memory;
+    // Sized for the chunk before it runs; the code never pushes past it.
+    std::pmr::vector<Value> stack;
+    Environment environment;
+    ExecutionStats stats;
+};
+
+#endif
@@ -0,0 +1,13 @@
+# A script that enters tens of thousands of scopes, some of them nested
+# four deep, must print the same on every engine with every memory resource.
+"$IOWA" tests/alloc/scopes.ia > "$SCRATCH/expected" 2>&1
+echo "exit $?"
+cat "$SCRATCH/expected"
+for engine in tree vm closure; do
+    for alloc in global monotonic pool; do
+        "$IOWA" --engine=$engine --alloc=$alloc tests/alloc/scopes.ia > "$SCRATCH/actual" 2>&1
+        cmp -s "$SCRATCH/expected" "$SCRATCH/actual" || echo "$engine with $alloc differs"
+    done
+done
+"$IOWA" --stream --alloc=pool tests/alloc/scopes.ia > "$SCRATCH/actual" 2>&1
+cmp -s "$SCRATCH/expected" "$SCRATCH/actual" || echo "streamed with pool differs"
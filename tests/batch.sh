@@ -0,0 +1,14 @@
+# Scripts finish in any order but print in the order given, each followed on
+# stderr by its status line. One failure makes the exit status 1; a script
+# that fails while running keeps what it printed before the error.
+run() {
+    "$IOWA" "$@" > "$SCRATCH/stdout" 2> "$SCRATCH/stderr"
+    echo "exit $?"
+    cat "$SCRATCH/stdout"
+    cat "$SCRATCH/stderr"
+}
+
+run --batch --jobs=3 tests/batch/counting.ia tests/batch/syntax_error.ia \
+    tests/batch/greeting.ia tests/batch/division_by_zero.ia
+run --jobs=2 --manifest=tests/batch/passing.txt
+run --batch --jobs=1 tests/batch/greeting.ia tests/batch/counting.ia tests/batch/greeting.ia
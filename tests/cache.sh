@@ -0,0 +1,38 @@
+# A run that finds its entry skips parsing. Damaged, truncated and empty
+# entries are ignored and rewritten, and every run prints the same.
+cache=$SCRATCH/cache
+run() {
+    "$IOWA" --cache="$cache" --profile "$@" tests/cache/script.ia > "$SCRATCH/stdout" 2> "$SCRATCH/profile"
+    status=$?
+    if grep -q '^parse ' "$SCRATCH/profile"; then
+        echo "miss, exit $status"
+    else
+        echo "hit, exit $status"
+    fi
+    cat "$SCRATCH/stdout"
+}
+
+run
+run
+entry=$(ls "$cache"/*.iast)
+
+echo "damaged entry"
+printf 'XXXXXXXX' | dd of="$entry" bs=1 seek=120 conv=notrunc 2> /dev/null
+run
+run
+
+echo "truncated entry"
+head -c 100 "$entry" > "$SCRATCH/truncated"
+mv "$SCRATCH/truncated" "$entry"
+run
+run
+
+echo "empty entry"
+: > "$entry"
+run
+run
+
+echo "other optimization level"
+run -O0
+run -O0
+ls "$cache" | wc -l | tr -d " "
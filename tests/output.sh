@@ -0,0 +1,19 @@
+# Both scripts print 0 to 19999, over 100 KiB, which is more than the
+# output buffer holds. Everything must come out, in order, on stdout and
+# through --output alike, and a script that fails afterwards must still
+# have printed all of it.
+seq 0 19999 > "$SCRATCH/expected"
+for engine in tree vm closure; do
+    "$IOWA" --engine=$engine tests/output/many_lines.ia > "$SCRATCH/stdout"
+    echo "$engine: exit $?"
+    cmp -s "$SCRATCH/expected" "$SCRATCH/stdout" || echo "$engine: stdout differs"
+    rm -f "$SCRATCH/file"
+    "$IOWA" --engine=$engine --output="$SCRATCH/file" tests/output/many_lines.ia > "$SCRATCH/stdout"
+    echo "$engine --output: exit $?"
+    [ -s "$SCRATCH/stdout" ] && echo "$engine: --output also wrote to stdout"
+    cmp -s "$SCRATCH/expected" "$SCRATCH/file" || echo "$engine: --output file differs"
+    "$IOWA" --engine=$engine tests/output/fails_late.ia > "$SCRATCH/stdout" 2> "$SCRATCH/stderr"
+    echo "$engine failing: exit $?"
+    cat "$SCRATCH/stderr"
+    cmp -s "$SCRATCH/expected" "$SCRATCH/stdout" || echo "$engine: output before the error differs"
+done
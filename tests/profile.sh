@@ -0,0 +1,10 @@
+# Times vary from run to run, so only the line and hit columns of the
+# --hot-lines report and the stacks of --collapsed are compared, each
+# sorted; every collapsed stack must still carry a positive time.
+"$IOWA" --hot-lines --collapsed="$SCRATCH/stacks" tests/profile/nested.ia 2> "$SCRATCH/report"
+echo "exit $?"
+awk '$1 ~ /^[0-9]+$/ { print "line", $1, $2 }' "$SCRATCH/report" | sort -k2n
+awk '$2 ~ /^[0-9]+:[0-9]+$/ { print $1, $2, $3 }' "$SCRATCH/report" | sort
+awk '$NF < 1 { print "no time:", $0 }' "$SCRATCH/stacks"
+sed 's/ [0-9]*$//' "$SCRATCH/stacks" | sort
+"$IOWA" --hot-lines=2 tests/profile/nested.ia 2>&1 >/dev/null | awk '$1 ~ /^[0-9]+$/' | wc -l
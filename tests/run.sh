@@ -0,0 +1,52 @@
+#!/bin/sh
+# Runs every test in tests/ and compares it with its .out file, which holds
+# what the test printed to stdout, then to stderr, then "exit <status>".
+#
+#   name.ia    a script run on its own on every engine, with the options in
+#              name.args if any; each engine must print the same
+#   name.sh    runs several commands instead, with the interpreter in $IOWA
+#              and an empty directory of its own in $SCRATCH
+#
+# Run from the top of the repository: ./tests/run.sh [path/to/Iowa]
+
+IOWA=${1:-./bin/Iowa}
+export IOWA
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+
+engines="tree vm closure"
+passed=0
+failed=0
+
+# Compares the output the last run left in $scratch, and its exit status,
+# with the expected file.
+check() {
+    { cat "$scratch/stdout" "$scratch/stderr"; echo "exit $3"; } > "$scratch/actual"
+    if diff -u "$2" "$scratch/actual" > "$scratch/diff"; then
+        passed=$((passed + 1))
+    else
+        echo "FAIL $1"
+        cat "$scratch/diff"
+        failed=$((failed + 1))
+    fi
+}
+
+for expected in tests/*.out; do
+    name=${expected%.out}
+    SCRATCH=$scratch/$(basename "$name")
+    export SCRATCH
+    mkdir "$SCRATCH"
+    if [ -f "$name.sh" ]; then
+        sh "$name.sh" > "$scratch/stdout" 2> "$scratch/stderr"
+        check "$name" "$expected" $?
+        continue
+    fi
+    for engine in $engines; do
+        "$IOWA" --engine=$engine $(cat "$name.args" 2>/dev/null) "$name.ia" \
+            > "$scratch/stdout" 2> "$scratch/stderr"
+        check "$name ($engine)" "$expected" $?
+    done
+done
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,12 @@
+# Scans two scripts whole and then cut into 2 to 8 pieces. Most of the cuts
+# would fall inside or next to a multi-line string, so each split has to
+# find the same tokens and count the same lines as the whole script.
+for script in tests/scan/strings.ia tests/scan/strings_error.ia; do
+    "$IOWA" "$script" > "$SCRATCH/whole" 2>&1
+    echo "$script exit $?"
+    cat "$SCRATCH/whole"
+    for workers in 2 3 4 5 6 7 8; do
+        "$IOWA" --scan-workers=$workers "$script" > "$SCRATCH/pieces" 2>&1
+        cmp -s "$SCRATCH/whole" "$SCRATCH/pieces" || echo "$workers pieces differ"
+    done
+done
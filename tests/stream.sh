@@ -0,0 +1,26 @@
+# Runs each script test that takes no options with --stream as well. A
+# streamed run prints everything the whole run prints, and the same when
+# the whole run succeeds; a script that fails partway has printed what came
+# before the failure. Errors found before running stop a whole run at once
+# but a streamed run only where they occur, so then it may print more.
+for script in tests/*.ia tests/stream/*.ia; do
+    [ -f "${script%.ia}.args" ] && continue
+    "$IOWA" "$script" > "$SCRATCH/whole" 2> /dev/null
+    whole_status=$?
+    "$IOWA" --stream "$script" > "$SCRATCH/streamed" 2> "$SCRATCH/errors"
+    streamed_status=$?
+    if [ $whole_status -ne $streamed_status ]; then
+        echo "$script: exit $whole_status whole, $streamed_status streamed"
+    elif [ $whole_status -eq 0 ]; then
+        cmp -s "$SCRATCH/whole" "$SCRATCH/streamed" || echo "$script: streamed output differs"
+    else
+        head -c "$(wc -c < "$SCRATCH/whole")" "$SCRATCH/streamed" | cmp -s - "$SCRATCH/whole" ||
+            echo "$script: streamed output does not start with the whole run's"
+    fi
+done
+
+for script in tests/stream/*.ia; do
+    echo "$script"
+    "$IOWA" --stream "$script" 2>&1
+    echo "exit $?"
+done
@@ -0,0 +1,13 @@
+# Each script is built with --compile, which uses $IOWA_CXX, and the program
+# it builds must print and exit as the interpreter does.
+for script in tests/translate/int_min.ia tests/translate/nul_string.ia tests/int_overflow.ia \
+    tests/optimize.ia tests/type_runtime_error.ia; do
+    "$IOWA" "$script" > "$SCRATCH/interpreted" 2>&1
+    echo "exit $?" >> "$SCRATCH/interpreted"
+    echo "$script"
+    cat "$SCRATCH/interpreted"
+    "$IOWA" --compile --output="$SCRATCH/compiled" "$script" || continue
+    "$SCRATCH/compiled" > "$SCRATCH/native" 2>&1
+    echo "exit $?" >> "$SCRATCH/native"
+    cmp -s "$SCRATCH/interpreted" "$SCRATCH/native" || echo "compiled program differs"
+done